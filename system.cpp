@@ -12,6 +12,39 @@
 #include <sstream>
 #include <chrono>
 #include <set> // Added for std::set
+#include <unordered_map>
+#include <tuple>
+#include <cstdio>
+#include <string_view>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <filesystem>
+#include <future>
+#include <thread>
+#include <atomic>
+#include <queue>
+#include <unordered_set>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <random>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define CSV_SCAN_X86 1
+#endif
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#endif
 
 using namespace std;
 
@@ -33,18 +66,42 @@ namespace DateUtil {
         return ss.str();
     }
     
-    bool isValidDateFormat(const string& date) {
+    // Civil date <-> day count since 1970-01-01 (proleptic Gregorian)
+    long daysFromCivil(int year, int month, int day) {
+        year -= month <= 2;
+        const long era = (year >= 0 ? year : year - 399) / 400;
+        const long yoe = year - era * 400;
+        const long doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+        const long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+        return era * 146097 + doe - 719468;
+    }
+    
+    void civilFromDays(long days, int& year, int& month, int& day) {
+        days += 719468;
+        const long era = (days >= 0 ? days : days - 146096) / 146097;
+        const long doe = days - era * 146097;
+        const long yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+        const long doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+        const long mp = (5 * doy + 2) / 153;
+        day = static_cast<int>(doy - (153 * mp + 2) / 5 + 1);
+        month = static_cast<int>(mp < 10 ? mp + 3 : mp - 9);
+        year = static_cast<int>(yoe + era * 400 + (month <= 2));
+    }
+    
+    // Parses YYYY-MM-DD (years 1900-2100) into a day count without allocating
+    bool parseDate(string_view date, long& days) {
         if (date.length() != 10) return false;
         if (date[4] != '-' || date[7] != '-') return false;
         
         for (int i = 0; i < 10; i++) {
             if (i == 4 || i == 7) continue;
-            if (!isdigit(date[i])) return false;
+            if (!isdigit(static_cast<unsigned char>(date[i]))) return false;
         }
         
-        int year = stoi(date.substr(0, 4));
-        int month = stoi(date.substr(5, 2));
-        int day = stoi(date.substr(8, 2));
+        auto digit = [&](int i) { return date[i] - '0'; };
+        int year = digit(0) * 1000 + digit(1) * 100 + digit(2) * 10 + digit(3);
+        int month = digit(5) * 10 + digit(6);
+        int day = digit(8) * 10 + digit(9);
         
         if (year < 1900 || year > 2100) return false;
         if (month < 1 || month > 12) return false;
@@ -58,512 +115,4234 @@ namespace DateUtil {
             if (day > (isLeapYear ? 29 : 28)) return false;
         }
         
+        days = daysFromCivil(year, month, day);
         return true;
     }
     
-    bool isEarlierDate(const string& date1, const string& date2) {
-        return date1 < date2; 
+    bool isValidDateFormat(string_view date) {
+        long days;
+        return parseDate(date, days);
     }
 }
 
-class Person {
-protected:
-    string id;
-    string name;
-    string gender;
-    string phoneNumber;
+// Calendar date packed as a day count since 1970-01-01. Parsed once at the
+// input/load boundary; comparisons and arithmetic are plain integer ops.
+class Date {
+private:
+    int32_t days = 0;
     
 public:
-    Person(const string& id, const string& name, const string& gender, const string& phoneNumber)
-        : id(id), name(name), gender(gender), phoneNumber(phoneNumber) {}
-    
-    virtual ~Person() = default;
+    Date() = default;
+    explicit Date(int32_t days) : days(days) {}
     
-    string getId() const { return id; }
-    string getName() const { return name; }
-    string getGender() const { return gender; }
-    string getPhoneNumber() const { return phoneNumber; }
+    static bool tryParse(string_view text, Date& out) {
+        long parsed;
+        if (!DateUtil::parseDate(text, parsed)) return false;
+        out = Date(static_cast<int32_t>(parsed));
+        return true;
+    }
     
-    void setName(const string& name) { this->name = name; }
-    void setGender(const string& gender) { this->gender = gender; }
-    void setPhoneNumber(const string& phone) { this->phoneNumber = phone; }
+    static Date parse(string_view text) {
+        Date date;
+        if (!tryParse(text, date)) {
+            throw runtime_error("Invalid date format. Expected YYYY-MM-DD");
+        }
+        return date;
+    }
     
-    virtual string serialize() const {
-        return id + "," + name + "," + gender + "," + phoneNumber;
+    static Date today() {
+        return parse(DateUtil::getCurrentDate());
     }
     
-    virtual void display() const {
-        cout << "ID: " << id << "\n";
-        cout << "Name: " << name << "\n";
-        cout << "Gender: " << gender << "\n";
-        cout << "Phone: " << phoneNumber << "\n";
+    int32_t dayNumber() const { return days; }
+    Date addDays(int count) const { return Date(days + count); }
+    
+    // 0 = Monday ... 6 = Sunday (1970-01-01 was a Thursday)
+    int weekday() const { return static_cast<int>(((days % 7) + 7 + 3) % 7); }
+    
+    string toString() const {
+        int year, month, day;
+        DateUtil::civilFromDays(days, year, month, day);
+        char text[11] = {
+            static_cast<char>('0' + year / 1000), static_cast<char>('0' + year / 100 % 10),
+            static_cast<char>('0' + year / 10 % 10), static_cast<char>('0' + year % 10), '-',
+            static_cast<char>('0' + month / 10), static_cast<char>('0' + month % 10), '-',
+            static_cast<char>('0' + day / 10), static_cast<char>('0' + day % 10), '\0'
+        };
+        return string(text, 10);
     }
+    
+    bool operator==(Date other) const { return days == other.days; }
+    bool operator!=(Date other) const { return days != other.days; }
+    bool operator<(Date other) const { return days < other.days; }
+    bool operator<=(Date other) const { return days <= other.days; }
+    bool operator>(Date other) const { return days > other.days; }
+    bool operator>=(Date other) const { return days >= other.days; }
 };
 
-class Patient : public Person {
+ostream& operator<<(ostream& out, Date date) {
+    return out << date.toString();
+}
+
+// Time of day packed as minutes since midnight
+class TimeOfDay {
 private:
-    string dateOfBirth;
-    string bloodType;
-    vector<string> medicalHistory;
-    string insuranceInfo;
+    uint16_t minutes = 0;
     
 public:
-    Patient(const string& id, const string& name, const string& gender, 
-            const string& phoneNumber, const string& dateOfBirth, 
-            const string& bloodType, const string& insuranceInfo)
-        : Person(id, name, gender, phoneNumber), 
-          dateOfBirth(dateOfBirth), bloodType(bloodType), insuranceInfo(insuranceInfo) {}
-    
-    string getDateOfBirth() const { return dateOfBirth; }
-    string getBloodType() const { return bloodType; }
-    const vector<string>& getMedicalHistory() const { return medicalHistory; }
-    string getInsuranceInfo() const { return insuranceInfo; }
-    
-    void setDateOfBirth(const string& dob) { this->dateOfBirth = dob; }
-    void setBloodType(const string& bt) { this->bloodType = bt; }
-    void setInsuranceInfo(const string& info) { this->insuranceInfo = info; }
+    TimeOfDay() = default;
+    explicit TimeOfDay(int minutes) : minutes(static_cast<uint16_t>(minutes)) {}
     
-    void addMedicalHistoryEntry(const string& entry) {
-        string timestamp = DateUtil::getCurrentDate();
-        medicalHistory.push_back(timestamp + ": " + entry);
+    // Local wall-clock time, to the minute
+    static TimeOfDay now() {
+        time_t now_time = chrono::system_clock::to_time_t(chrono::system_clock::now());
+        tm* now_tm = localtime(&now_time);
+        return TimeOfDay(now_tm->tm_hour * 60 + now_tm->tm_min);
     }
     
-    string serialize() const override {
-        string basicInfo = Person::serialize();
-        string medHistory;
+    // Accepts HH:MM or H:MM on a 24-hour clock. Times were free text before
+    // they were validated, so seconds (dropped), a 12-hour "am"/"pm" suffix
+    // ("9am", "2:30 PM") and surrounding spaces are accepted as well.
+    static bool tryParse(string_view text, TimeOfDay& out) {
+        auto trimEnd = [&]() { while (!text.empty() && isspace(static_cast<unsigned char>(text.back()))) text.remove_suffix(1); };
+        while (!text.empty() && isspace(static_cast<unsigned char>(text.front()))) text.remove_prefix(1);
+        trimEnd();
         
-        for (const auto& entry : medicalHistory) {
-            medHistory += entry + "|";
+        int meridiem = 0; // 1 = am, 2 = pm
+        if (text.size() >= 2 && tolower(static_cast<unsigned char>(text.back())) == 'm') {
+            char half = static_cast<char>(tolower(static_cast<unsigned char>(text[text.size() - 2])));
+            if (half == 'a' || half == 'p') {
+                meridiem = (half == 'a') ? 1 : 2;
+                text.remove_suffix(2);
+                trimEnd();
+            }
         }
-        if (!medicalHistory.empty()) {
-            medHistory.pop_back(); 
+        
+        // Hour, then up to two ':'-separated two-digit fields
+        int parts[3] = {0, 0, 0};
+        size_t count = 0;
+        size_t pos = 0;
+        while (true) {
+            size_t digits = 0;
+            int value = 0;
+            for (; pos < text.size() && digits < 2 && isdigit(static_cast<unsigned char>(text[pos])); pos++, digits++) {
+                value = value * 10 + (text[pos] - '0');
+            }
+            if (digits == 0 || (count > 0 && digits != 2)) return false;
+            parts[count++] = value;
+            if (pos == text.size()) break;
+            if (text[pos] != ':' || count == 3) return false;
+            pos++;
         }
+        if (count == 1 && meridiem == 0) return false;
         
-        return basicInfo + "," + dateOfBirth + "," + bloodType + "," + 
-               medHistory + "," + insuranceInfo;
+        int hour = parts[0];
+        int minute = parts[1];
+        if (minute > 59 || parts[2] > 59) return false;
+        if (meridiem != 0) {
+            if (hour < 1 || hour > 12) return false;
+            hour = hour % 12 + (meridiem == 2 ? 12 : 0);
+        } else if (hour > 23) {
+            return false;
+        }
+        out = TimeOfDay(hour * 60 + minute);
+        return true;
     }
     
-    void display() const override {
-        Person::display();
-        cout << "Date of Birth: " << dateOfBirth << "\n";
-        cout << "Blood Type: " << bloodType << "\n";
-        cout << "Insurance: " << insuranceInfo << "\n";
-        
-        cout << "Medical History:\n";
-        if (medicalHistory.empty()) {
-            cout << "  No records available\n";
-        } else {
-            for (const auto& entry : medicalHistory) {
-                cout << "  " << entry << "\n";
-            }
+    static TimeOfDay parse(string_view text) {
+        TimeOfDay time;
+        if (!tryParse(text, time)) {
+            throw runtime_error("Invalid time format. Expected HH:MM");
+        }
+        return time;
+    }
+    
+    int minutesSinceMidnight() const { return minutes; }
+    
+    string toString() const {
+        char text[5] = {
+            static_cast<char>('0' + minutes / 600), static_cast<char>('0' + minutes / 60 % 10), ':',
+            static_cast<char>('0' + minutes % 60 / 10), static_cast<char>('0' + minutes % 10)
+        };
+        return string(text, 5);
+    }
+    
+    bool operator==(TimeOfDay other) const { return minutes == other.minutes; }
+    bool operator!=(TimeOfDay other) const { return minutes != other.minutes; }
+    bool operator<(TimeOfDay other) const { return minutes < other.minutes; }
+};
+
+ostream& operator<<(ostream& out, TimeOfDay time) {
+    return out << time.toString();
+}
+
+namespace BitUtil {
+    int lowestSetBit(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_ctzll(word);
+#else
+        int bit = 0;
+        while (!(word & 1)) {
+            word >>= 1;
+            bit++;
         }
+        return bit;
+#endif
+    }
+    
+    int popCount(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_popcountll(word);
+#else
+        int count = 0;
+        for (; word; word &= word - 1) count++;
+        return count;
+#endif
     }
     
-    static shared_ptr<Patient> deserialize(const string& data) {
-        vector<string> parts;
-        string part;
-        istringstream dataStream(data);
+    // Bits [from, to] of a word set, 0 <= from <= to <= 63
+    uint64_t rangeMask(int from, int to) {
+        uint64_t upper = (to == 63) ? ~0ULL : ((1ULL << (to + 1)) - 1);
+        return upper & ~((1ULL << from) - 1);
+    }
+}
+
+namespace CsvUtil {
+    // Marks the bytes equal to either of two structural characters: bit i % 64
+    // of masks[i / 64] is set for data[i]. The x86 versions compare 16 (SSE2) or
+    // 32 (AVX2) bytes per instruction. A short last block is read as the final
+    // 64 bytes of the input, or from a zero-padded copy when the input is
+    // shorter than that. `masks` needs (size + 63) / 64 words.
+    namespace Scan {
+        using Classifier = void (*)(const char* data, size_t size, char a, char b, uint64_t* masks);
+        
+        void scalar(const char* data, size_t size, char a, char b, uint64_t* masks) {
+            for (size_t word = 0; word * 64 < size; word++) {
+                uint64_t mask = 0;
+                size_t length = min<size_t>(64, size - word * 64);
+                for (size_t i = 0; i < length; i++) {
+                    char c = data[word * 64 + i];
+                    mask |= static_cast<uint64_t>(c == a || c == b) << i;
+                }
+                masks[word] = mask;
+            }
+        }
         
-        while (getline(dataStream, part, ',')) {
-            parts.push_back(part);
+#ifdef CSV_SCAN_X86
+        uint64_t sse2Block(const char* block, __m128i first, __m128i second) {
+            uint64_t mask = 0;
+            for (int part = 0; part < 4; part++) {
+                __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + part * 16));
+                __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(bytes, first), _mm_cmpeq_epi8(bytes, second));
+                mask |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(hits))) << (part * 16);
+            }
+            return mask;
         }
         
-        if (parts.size() < 8) {
-            throw runtime_error("Invalid patient data format");
+        void sse2(const char* data, size_t size, char a, char b, uint64_t* masks) {
+            const __m128i first = _mm_set1_epi8(a);
+            const __m128i second = _mm_set1_epi8(b);
+            size_t word = 0;
+            for (; (word + 1) * 64 <= size; word++) {
+                masks[word] = sse2Block(data + word * 64, first, second);
+            }
+            size_t rest = size - word * 64;
+            if (rest > 0 && size >= 64) {
+                masks[word] = sse2Block(data + size - 64, first, second) >> (64 - rest);
+            } else if (rest > 0) {
+                char tail[64] = {};
+                memcpy(tail, data + word * 64, rest);
+                masks[word] = sse2Block(tail, first, second);
+            }
         }
         
-        auto patient = make_shared<Patient>(
-            parts[0], parts[1], parts[2], parts[3], parts[4], parts[5], parts[7]
-        );
+#if defined(__GNUC__) || defined(__clang__)
+        // Built for AVX2 regardless of compiler flags; only called when the CPU has it
+        __attribute__((target("avx2")))
+        uint64_t avx2Block(const char* block, __m256i first, __m256i second) {
+            __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+            __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32));
+            __m256i lowHits = _mm256_or_si256(_mm256_cmpeq_epi8(low, first), _mm256_cmpeq_epi8(low, second));
+            __m256i highHits = _mm256_or_si256(_mm256_cmpeq_epi8(high, first), _mm256_cmpeq_epi8(high, second));
+            return static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(lowHits))) |
+                   static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(highHits))) << 32;
+        }
         
-        if (!parts[6].empty()) {
-            istringstream historyStream(parts[6]);
-            string entry;
-            while (getline(historyStream, entry, '|')) {
-                patient->medicalHistory.push_back(entry);
+        __attribute__((target("avx2")))
+        void avx2(const char* data, size_t size, char a, char b, uint64_t* masks) {
+            const __m256i first = _mm256_set1_epi8(a);
+            const __m256i second = _mm256_set1_epi8(b);
+            size_t word = 0;
+            for (; (word + 1) * 64 <= size; word++) {
+                masks[word] = avx2Block(data + word * 64, first, second);
+            }
+            size_t rest = size - word * 64;
+            if (rest > 0 && size >= 64) {
+                masks[word] = avx2Block(data + size - 64, first, second) >> (64 - rest);
+            } else if (rest > 0) {
+                char tail[64] = {};
+                memcpy(tail, data + word * 64, rest);
+                masks[word] = avx2Block(tail, first, second);
             }
         }
+#endif
+#endif
         
-        return patient;
+        // Every version this build and CPU can run, best last
+        vector<pair<const char*, Classifier>> available() {
+            vector<pair<const char*, Classifier>> classifiers = {{"scalar", scalar}};
+#ifdef CSV_SCAN_X86
+            classifiers.push_back({"SSE2", sse2});
+#if defined(__GNUC__) || defined(__clang__)
+            __builtin_cpu_init(); // May run before the runtime's own CPU detection
+            if (__builtin_cpu_supports("avx2")) {
+                classifiers.push_back({"AVX2", avx2});
+            }
+#endif
+#endif
+            return classifiers;
+        }
+        
+        Classifier active = available().back().second;
     }
-};
-
-class Doctor : public Person {
-private:
-    string specialization;
-    string licenseNumber;
-    set<string> availableDays; // Changed from vector to set
-    string departmentId;
-    
-public:
-    Doctor(const string& id, const string& name, const string& gender, 
-           const string& phoneNumber, const string& specialization, 
-           const string& licenseNumber, const string& departmentId)
-        : Person(id, name, gender, phoneNumber), specialization(specialization), 
-          licenseNumber(licenseNumber), departmentId(departmentId) {}
-    
-    string getSpecialization() const { return specialization; }
-    string getLicenseNumber() const { return licenseNumber; }
-    const set<string>& getAvailableDays() const { return availableDays; } // Return type changed
-    string getDepartmentId() const { return departmentId; }
-    
-    void setSpecialization(const string& spec) { this->specialization = spec; }
-    void setLicenseNumber(const string& license) { this->licenseNumber = license; }
-    void setDepartmentId(const string& deptId) { this->departmentId = deptId; }
     
-    void addAvailableDay(const string& day) {
-        availableDays.insert(day); // set::insert handles duplicates
+    // Calls onHit(index) for every position from `from` on that holds `a` or
+    // `b`, in order, until it returns false. Classifies 4 KiB at a time.
+    template <typename Callback>
+    void forEachHit(string_view text, size_t from, char a, char b, Callback onHit) {
+        const size_t windowWords = 64;
+        uint64_t masks[windowWords];
+        while (from < text.size()) {
+            size_t length = min(text.size() - from, windowWords * 64);
+            Scan::active(text.data() + from, length, a, b, masks);
+            for (size_t word = 0; word * 64 < length; word++) {
+                for (uint64_t bits = masks[word]; bits; bits &= bits - 1) {
+                    if (!onHit(from + word * 64 + BitUtil::lowestSetBit(bits))) return;
+                }
+            }
+            from += length;
+        }
     }
     
-    void removeAvailableDay(const string& day) {
-        availableDays.erase(day); // set::erase
+    // Calls onEnd(index) for the newline ending each record from `start`,
+    // which must be the first byte of a record, until it returns false. As in
+    // FieldReader, a quote opens a quoted field only as the first byte of a
+    // field; elsewhere it is text, as older versions wrote such fields unquoted.
+    template <typename Callback>
+    void forEachRecordEnd(string_view text, size_t start, Callback onEnd) {
+        bool quoted = false;
+        size_t skipUntil = 0; // Second quote of an escaped pair
+        forEachHit(text, start, '\n', '"', [&](size_t at) {
+            if (at < skipUntil) return true;
+            if (text[at] == '\n') {
+                if (quoted) return true;
+                start = at + 1;
+                return onEnd(at);
+            }
+            if (quoted) {
+                if (at + 1 < text.size() && text[at + 1] == '"') {
+                    skipUntil = at + 2;
+                } else {
+                    quoted = false;
+                }
+            } else if (at == start || text[at - 1] == ',') {
+                quoted = true;
+            }
+            return true;
+        });
     }
     
-    bool isAvailableOn(const string& day) const {
-        return availableDays.count(day) > 0; // set::count is O(log N)
+    // Calls onRecord for every non-empty RFC 4180 record in `text`, without
+    // copying. Newlines inside quoted fields do not end a record.
+    template <typename Callback>
+    void forEachRecord(string_view text, Callback onRecord) {
+        size_t start = 0;
+        auto emit = [&](size_t end) {
+            string_view record = text.substr(start, end - start);
+            if (!record.empty() && record.back() == '\r') {
+                record.remove_suffix(1);
+            }
+            if (!record.empty()) {
+                onRecord(record);
+            }
+            start = end + 1;
+        };
+        forEachRecordEnd(text, 0, [&](size_t end) {
+            emit(end);
+            return true;
+        });
+        if (start < text.size()) {
+            emit(text.size());
+        }
     }
     
-    string serialize() const override {
-        string basicInfo = Person::serialize();
-        string availDaysStr;
+    // Reads the fields of one record in order. The record's commas and quotes
+    // are classified once up front. Plain fields come back as views into the
+    // record; quoted ones are unescaped into a buffer that the next call
+    // reuses. A quote inside a plain field is kept as text.
+    class FieldReader {
+    private:
+        static const size_t inlineWords = 8;
         
-        for (const auto& day : availableDays) {
-            availDaysStr += day + "|";
-        }
-        if (!availableDays.empty()) {
-            availDaysStr.pop_back(); 
-        }
+        string_view record;
+        size_t position = 0;
+        bool more = true;
+        string unescaped;
+        uint64_t inlineMasks[inlineWords];
+        vector<uint64_t> largeMasks; // Records over 512 bytes
+        const uint64_t* masks;
         
-        return basicInfo + "," + specialization + "," + licenseNumber + "," +
-               availDaysStr + "," + departmentId;
-    }
-    
-    void display() const override {
-        Person::display();
-        cout << "Specialization: " << specialization << "\n";
-        cout << "License Number: " << licenseNumber << "\n";
-        cout << "Department ID: " << departmentId << "\n";
+        // Next comma or quote at or after `from`, or npos
+        size_t nextDelimiter(size_t from) const {
+            size_t words = (record.size() + 63) / 64;
+            size_t word = from / 64;
+            if (word >= words) return string_view::npos;
+            uint64_t bits = masks[word] & (~0ULL << (from % 64));
+            while (!bits) {
+                if (++word == words) return string_view::npos;
+                bits = masks[word];
+            }
+            return word * 64 + BitUtil::lowestSetBit(bits);
+        }
         
-        cout << "Available Days: ";
-        if (availableDays.empty()) {
-            cout << "None set\n";
-        } else {
-            bool first = true;
-            for (const auto& day : availableDays) {
-                if (!first) {
-                    cout << ", ";
+        string_view nextQuoted() {
+            unescaped.clear();
+            size_t start = position + 1;
+            while (true) {
+                size_t quote = record.find('"', start);
+                if (quote == string_view::npos) {
+                    throw runtime_error("Unterminated quoted field");
                 }
-                cout << day;
-                first = false;
+                unescaped.append(record.data() + start, quote - start);
+                if (quote + 1 < record.size() && record[quote + 1] == '"') {
+                    unescaped.push_back('"');
+                    start = quote + 2;
+                    continue;
+                }
+                
+                position = quote + 1;
+                if (position == record.size()) {
+                    more = false;
+                } else if (record[position] == ',') {
+                    position++;
+                } else {
+                    throw runtime_error("Unexpected text after quoted field");
+                }
+                return unescaped;
             }
-            cout << "\n";
         }
-    }
-    
-    static shared_ptr<Doctor> deserialize(const string& data) {
-        vector<string> parts;
-        string part;
-        istringstream dataStream(data);
         
-        while (getline(dataStream, part, ',')) {
-            parts.push_back(part);
+    public:
+        explicit FieldReader(string_view record) : record(record), masks(inlineMasks) {
+            size_t words = (record.size() + 63) / 64;
+            if (words > inlineWords) {
+                largeMasks.resize(words);
+                masks = largeMasks.data();
+            }
+            Scan::active(record.data(), record.size(), ',', '"', const_cast<uint64_t*>(masks));
         }
         
-        if (parts.size() < 8) {
-            throw runtime_error("Invalid doctor data format");
-        }
+        FieldReader(const FieldReader&) = delete;
+        FieldReader& operator=(const FieldReader&) = delete;
         
-        auto doctor = make_shared<Doctor>(
-            parts[0], parts[1], parts[2], parts[3], parts[4], parts[5], parts[7]
-        );
+        bool hasMore() const { return more; }
         
-        if (!parts[6].empty()) {
-            istringstream daysStream(parts[6]);
-            string day;
-            while (getline(daysStream, day, '|')) {
-                doctor->availableDays.insert(day); // Insert into set
+        string_view next() {
+            if (position < record.size() && record[position] == '"') {
+                return nextQuoted();
+            }
+            size_t end = nextDelimiter(position);
+            while (end != string_view::npos && record[end] == '"') {
+                end = nextDelimiter(end + 1);
             }
+            
+            string_view field = record.substr(position, end == string_view::npos ? string_view::npos : end - position);
+            more = (end != string_view::npos);
+            position = end + 1;
+            return field;
         }
-        
-        return doctor;
-    }
-};
-
-class Department {
-private:
-    string id;
-    string name;
-    string location;
+    };
     
-public:
-    Department(const string& id, const string& name, const string& location)
-        : id(id), name(name), location(location) {}
+    // Quotes out[from..] in place if it holds a delimiter, quote or line break
+    void quoteField(string& out, size_t from) {
+        if (out.find_first_of(",\"\r\n", from) == string::npos) return;
+        string field = out.substr(from);
+        out.resize(from);
+        out.push_back('"');
+        for (char c : field) {
+            if (c == '"') out.push_back('"');
+            out.push_back(c);
+        }
+        out.push_back('"');
+    }
     
-    string getId() const { return id; }
-    string getName() const { return name; }
-    string getLocation() const { return location; }
+    // Splits `record` on `delimiter` into views over the same buffer. Stores at most
+    // maxFields views and returns the total number of fields found.
+    size_t splitFields(string_view record, char delimiter, string_view* fields, size_t maxFields) {
+        size_t count = 0;
+        size_t start = 0;
+        while (true) {
+            size_t end = record.find(delimiter, start);
+            if (count < maxFields) {
+                fields[count] = record.substr(start, end == string_view::npos ? string_view::npos : end - start);
+            }
+            count++;
+            if (end == string_view::npos) break;
+            start = end + 1;
+        }
+        return count;
+    }
     
-    void setName(const string& name) { this->name = name; }
-    void setLocation(const string& location) { this->location = location; }
+    // Calls onLine for every non-empty line in `text`, without copying
+    template <typename Callback>
+    void forEachLine(string_view text, Callback onLine) {
+        size_t start = 0;
+        while (start < text.size()) {
+            size_t end = text.find('\n', start);
+            if (end == string_view::npos) end = text.size();
+            
+            string_view line = text.substr(start, end - start);
+            if (!line.empty() && line.back() == '\r') {
+                line.remove_suffix(1);
+            }
+            if (!line.empty()) {
+                onLine(line);
+            }
+            start = end + 1;
+        }
+    }
     
-    string serialize() const {
-        return id + "," + name + "," + location;
+    // Calls onItem for every non-empty item of a '|'-joined list field
+    template <typename Callback>
+    void forEachListItem(string_view list, Callback onItem) {
+        size_t start = 0;
+        while (start < list.size()) {
+            size_t end = list.find('|', start);
+            if (end == string_view::npos) end = list.size();
+            if (end > start) {
+                onItem(list.substr(start, end - start));
+            }
+            start = end + 1;
+        }
     }
     
-    void display() const {
-        cout << "Department ID: " << id << "\n";
-        cout << "Name: " << name << "\n";
-        cout << "Location: " << location << "\n";
+    // Runs parse(record). If that throws for a record spanning several lines,
+    // a quote that opened a field but was never closed where it should be may
+    // have merged rows, so each line is retried on its own. Every failure is
+    // passed to onError rather than dropping the rows silently.
+    template <typename Parse, typename ErrorCallback>
+    void parseRecovering(string_view record, Parse parse, ErrorCallback onError) {
+        try {
+            parse(record);
+            return;
+        } catch (const exception& e) {
+            if (record.find('\n') == string_view::npos) {
+                onError(string(e.what()));
+                return;
+            }
+            onError(string(e.what()) + " (record spans several lines; reading them separately)");
+        }
+        forEachLine(record, [&](string_view line) {
+            try {
+                parse(line);
+            } catch (const exception& e) {
+                onError(string(e.what()));
+            }
+        });
     }
+}
+
+namespace ParallelLoad {
+    // Smallest slice worth handing to its own worker
+    const size_t minChunkBytes = 1 << 20;
     
-    static shared_ptr<Department> deserialize(const string& data) {
-        vector<string> parts;
-        string part;
-        istringstream dataStream(data);
+    // Splits `text` into at most maxChunks slices that end on record boundaries
+    vector<string_view> splitChunks(string_view text, size_t maxChunks) {
+        vector<string_view> chunks;
+        size_t count = max<size_t>(1, min(maxChunks, text.size() / minChunkBytes));
+        size_t target = text.size() / count + 1;
         
-        while (getline(dataStream, part, ',')) {
-            parts.push_back(part);
+        size_t start = 0;
+        while (start < text.size()) {
+            size_t end = min(text.size(), start + target);
+            if (end < text.size()) {
+                // Walk the records from the chunk start so quoted newlines are skipped
+                size_t target = end;
+                end = text.size();
+                CsvUtil::forEachRecordEnd(text, start, [&](size_t newline) {
+                    if (newline + 1 < target) return true;
+                    end = newline + 1;
+                    return false;
+                });
+            }
+            chunks.push_back(text.substr(start, end - start));
+            start = end;
         }
-        
-        if (parts.size() < 3) {
-            throw runtime_error("Invalid department data format");
+        return chunks;
+    }
+    
+    template <typename T>
+    struct ParsedChunk {
+        vector<shared_ptr<T>> records;
+        vector<string> errors;
+    };
+    
+    // Parses every record of `text` with T::deserialize, one worker per chunk.
+    // Chunks come back in file order so later rows still win on duplicate IDs.
+    template <typename T>
+    vector<ParsedChunk<T>> parseLines(string_view text, size_t workers) {
+        vector<future<ParsedChunk<T>>> pending;
+        for (string_view chunk : splitChunks(text, workers)) {
+            pending.push_back(async(launch::async, [chunk]() {
+                ParsedChunk<T> parsed;
+                CsvUtil::forEachRecord(chunk, [&](string_view record) {
+                    CsvUtil::parseRecovering(record, [&](string_view row) {
+                        parsed.records.push_back(T::deserialize(row));
+                    }, [&](string message) {
+                        parsed.errors.push_back(move(message));
+                    });
+                });
+                return parsed;
+            }));
         }
         
-        return make_shared<Department>(parts[0], parts[1], parts[2]);
+        vector<ParsedChunk<T>> results;
+        for (auto& task : pending) {
+            results.push_back(task.get());
+        }
+        return results;
     }
-};
+}
 
-class Appointment {
+// Little-endian-host binary encoding used by the snapshot file:
+// fixed-width integers and uint32 length-prefixed strings.
+class BinaryWriter {
 private:
-    string id;
-    string patientId;
-    string doctorId;
-    string date;
-    string time;
-    string status; 
-    string notes;
+    string buffer;
     
 public:
-    Appointment(const string& id, const string& patientId, const string& doctorId,
-                const string& date, const string& time, const string& status = "Scheduled",
-                const string& notes = "")
-        : id(id), patientId(patientId), doctorId(doctorId), date(date), time(time),
-          status(status), notes(notes) {}
-    
-    string getId() const { return id; }
-    string getPatientId() const { return patientId; }
-    string getDoctorId() const { return doctorId; }
-    string getDate() const { return date; }
-    string getTime() const { return time; }
-    string getStatus() const { return status; }
-    string getNotes() const { return notes; }
-    
-    void setDate(const string& date) { this->date = date; }
-    void setTime(const string& time) { this->time = time; }
-    void setStatus(const string& status) { this->status = status; }
-    void setNotes(const string& notes) { this->notes = notes; }
-    
-    string serialize() const {
-        return id + "," + patientId + "," + doctorId + "," + date + "," + 
-               time + "," + status + "," + notes;
+    template <typename T>
+    void writeFixed(T value) {
+        static_assert(is_integral<T>::value, "fixed-width fields must be integers");
+        buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
     }
     
-    void display() const {
-        cout << "Appointment ID: " << id << "\n";
-        cout << "Patient ID: " << patientId << "\n";
-        cout << "Doctor ID: " << doctorId << "\n";
-        cout << "Date: " << date << "\n";
-        cout << "Time: " << time << "\n";
-        cout << "Status: " << status << "\n";
-        if (!notes.empty()) {
-            cout << "Notes: " << notes << "\n";
-        }
+    void writeString(const string& value) {
+        writeFixed(static_cast<uint32_t>(value.size()));
+        buffer.append(value);
     }
     
-    static shared_ptr<Appointment> deserialize(const string& data) {
-        vector<string> parts;
-        string part;
-        istringstream dataStream(data);
-        
-        while (getline(dataStream, part, ',')) {
-            parts.push_back(part);
-        }
-        
-        if (parts.size() < 7) {
-            throw runtime_error("Invalid appointment data format");
-        }
-        
-        return make_shared<Appointment>(
-            parts[0], parts[1], parts[2], parts[3], parts[4], parts[5], parts[6]
-        );
-    }
+    const string& data() const { return buffer; }
 };
 
-class Hospital {
+class BinaryReader {
 private:
-    string name;
-    string address;
+    string_view input;
+    size_t position = 0;
     
-    map<string, shared_ptr<Patient>> patients;
-    map<string, shared_ptr<Doctor>> doctors;
-    map<string, shared_ptr<Department>> departments;
-    map<string, shared_ptr<Appointment>> appointments;
+    void require(size_t bytes) const {
+        if (input.size() - position < bytes) {
+            throw runtime_error("Unexpected end of binary data");
+        }
+    }
     
-    const string patientsFile = "patients.csv";
-    const string doctorsFile = "doctors.csv";
-    const string departmentsFile = "departments.csv";
-    const string appointmentsFile = "appointments.csv";
+public:
+    explicit BinaryReader(string_view input) : input(input) {}
     
-    string generateId(const string& prefix) const {
-        auto now = chrono::system_clock::now();
-        auto millis = chrono::duration_cast<chrono::milliseconds>(
-            now.time_since_epoch()
-        ).count() % 1000000;
-        
-        stringstream ss;
-        ss << prefix << setw(6) << setfill('0') << millis;
-        // Ensure uniqueness if multiple IDs are generated in the same millisecond for the same prefix (rare for manual input)
-        // A simple way is to check if it exists and retry, but for this system, it's likely okay.
-        // For high-concurrency systems, a more robust UUID or atomic counter would be needed.
-        string new_id = ss.str();
-        if (prefix == "P" && patients.count(new_id)) return generateId(prefix); // Basic retry
-        if (prefix == "D" && doctors.count(new_id)) return generateId(prefix);
-        if (prefix == "DP" && departments.count(new_id)) return generateId(prefix);
-        if (prefix == "A" && appointments.count(new_id)) return generateId(prefix);
-        return new_id;
+    template <typename T>
+    T readFixed() {
+        static_assert(is_integral<T>::value, "fixed-width fields must be integers");
+        require(sizeof(T));
+        T value;
+        memcpy(&value, input.data() + position, sizeof(T));
+        position += sizeof(T);
+        return value;
     }
     
-    void loadData() {
-        loadPatients();
-        loadDoctors();
-        loadDepartments();
-        loadAppointments();
+    string readString() {
+        string value;
+        readString(value);
+        return value;
     }
     
-    void saveData() const {
-        savePatients();
-        saveDoctors();
-        saveDepartments();
-        saveAppointments();
+    // Reuses the capacity `value` already has
+    void readString(string& value) {
+        uint32_t length = readFixed<uint32_t>();
+        require(length);
+        value.assign(input.data() + position, length);
+        position += length;
     }
     
-    void loadPatients() {
-        ifstream file(patientsFile);
-        if (!file) return;
-        
-        string line;
-        while (getline(file, line)) {
-            if (line.empty()) continue;
-            try {
-                auto patient = Patient::deserialize(line);
-                patients[patient->getId()] = patient;
-            } catch (const exception& e) {
-                cerr << "Error loading patient: " << e.what() << endl;
-            }
+    size_t remaining() const { return input.size() - position; }
+};
+
+namespace Checksum {
+    // 64-bit FNV-1a
+    uint64_t fnv1a(string_view data) {
+        uint64_t hash = 14695981039346656037ULL;
+        for (unsigned char c : data) {
+            hash ^= c;
+            hash *= 1099511628211ULL;
         }
+        return hash;
     }
+}
+
+// Read-only view of a whole file. Uses mmap where available so loaders can
+// parse straight out of the page cache; falls back to a single bulk read.
+class MappedFile {
+private:
+    const char* mapping = nullptr;
+    size_t length = 0;
+    bool opened = false;
+    string buffer; // fallback storage when the file is not mapped
     
-    void savePatients() const {
-        ofstream file(patientsFile);
-        if (!file) {
-            throw runtime_error("Could not open patients file for writing");
-        }
+public:
+    explicit MappedFile(const string& path) {
+#ifndef _WIN32
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
         
-        for (const auto& pair : patients) {
-            file << pair.second->serialize() << endl;
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            ::close(fd);
+            throw runtime_error("Could not stat " + path);
         }
-    }
-    
-    void loadDoctors() {
-        ifstream file(doctorsFile);
-        if (!file) return;
-        
-        string line;
-        while (getline(file, line)) {
-            if (line.empty()) continue;
-            try {
-                auto doctor = Doctor::deserialize(line);
-                doctors[doctor->getId()] = doctor;
-            } catch (const exception& e) {
-                cerr << "Error loading doctor: " << e.what() << endl;
+        opened = true;
+        length = static_cast<size_t>(info.st_size);
+        if (length > 0) {
+            void* addr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr == MAP_FAILED) {
+                ::close(fd);
+                throw runtime_error("Could not map " + path);
             }
+            madvise(addr, length, MADV_SEQUENTIAL);
+            mapping = static_cast<const char*>(addr);
         }
+        ::close(fd);
+#else
+        ifstream file(path, ios::binary);
+        if (!file) return;
+        opened = true;
+        buffer.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+        mapping = buffer.data();
+        length = buffer.size();
+#endif
     }
     
-    void saveDoctors() const {
-        ofstream file(doctorsFile);
-        if (!file) {
-            throw runtime_error("Could not open doctors file for writing");
-        }
-        
-        for (const auto& pair : doctors) {
-            file << pair.second->serialize() << endl;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    
+    ~MappedFile() {
+#ifndef _WIN32
+        if (mapping && length > 0) {
+            munmap(const_cast<char*>(mapping), length);
         }
+#endif
     }
     
-    void loadDepartments() {
-        ifstream file(departmentsFile);
-        if (!file) return;
+    bool isOpen() const { return opened; }
+    string_view view() const { return string_view(mapping, length); }
+};
+
+namespace FileUtil {
+    // False if the data may not have reached the disk
+    bool syncToDisk(FILE* f) {
+        if (fflush(f) != 0) return false;
+#ifdef _WIN32
+        return _commit(_fileno(f)) == 0;
+#else
+        return fsync(fileno(f)) == 0;
+#endif
+    }
+    
+    // Cuts an append-only file back to just after its last newline, dropping
+    // a record a crash left half-written; otherwise the next append would be
+    // glued onto it. Returns the number of bytes removed.
+    uintmax_t trimToLastLine(const string& path) {
+        error_code error;
+        uintmax_t size = filesystem::file_size(path, error);
+        if (error || size == 0) return 0;
         
+        ifstream in(path, ios::binary);
+        const uintmax_t blockSize = 4096;
+        uintmax_t end = size;
+        string block;
+        while (end > 0) {
+            uintmax_t start = end > blockSize ? end - blockSize : 0;
+            block.resize(static_cast<size_t>(end - start));
+            if (!in.seekg(static_cast<streamoff>(start)) || !in.read(&block[0], static_cast<streamsize>(block.size()))) {
+                return 0;
+            }
+            size_t newline = block.rfind('\n');
+            if (newline != string::npos) {
+                end = start + newline + 1;
+                break;
+            }
+            end = start;
+        }
+        if (end == size) return 0;
+        
+        in.close();
+        filesystem::resize_file(path, end);
+        return size - end;
+    }
+}
+
+// Fixed-size blocks carved from 64 KiB slabs. Freed blocks are reused;
+// slabs are kept until exit. Each thread caches a batch of free blocks, so
+// the shared lock is taken once per batch instead of once per object.
+class SlabPool {
+public:
+    class ThreadCache {
+    private:
+        friend class SlabPool;
+        SlabPool& owner;
+        void* head = nullptr;
+        size_t count = 0;
+        
+    public:
+        explicit ThreadCache(SlabPool& owner) : owner(owner) {}
+        ~ThreadCache() { owner.drain(*this, count); }
+        ThreadCache(const ThreadCache&) = delete;
+        ThreadCache& operator=(const ThreadCache&) = delete;
+        
+        void* allocate() {
+            if (!head) owner.refill(*this);
+            void* block = head;
+            head = next(block);
+            count--;
+            return block;
+        }
+        
+        void deallocate(void* block) {
+            next(block) = head;
+            head = block;
+            count++;
+            if (count > 2 * batchSize) owner.drain(*this, batchSize);
+        }
+    };
+    
+private:
+    static constexpr size_t batchSize = 64;
+    static constexpr size_t slabBytes = 64 * 1024;
+    
+    const size_t blockSize;
+    mutex lock;
+    vector<char*> slabs;
+    char* carved = nullptr;
+    char* slabEnd = nullptr;
+    void* freeList = nullptr;
+    
+    // Free blocks are linked through their first word
+    static void*& next(void* block) { return *static_cast<void**>(block); }
+    
+    void refill(ThreadCache& cache) {
+        lock_guard<mutex> guard(lock);
+        for (size_t i = 0; i < batchSize; i++) {
+            void* block = freeList;
+            if (block) {
+                freeList = next(block);
+            } else {
+                if (carved == slabEnd) {
+                    size_t bytes = max(slabBytes, blockSize * batchSize);
+                    carved = static_cast<char*>(::operator new(bytes));
+                    slabEnd = carved + bytes / blockSize * blockSize;
+                    slabs.push_back(carved);
+                }
+                block = carved;
+                carved += blockSize;
+            }
+            next(block) = cache.head;
+            cache.head = block;
+            cache.count++;
+        }
+    }
+    
+    void drain(ThreadCache& cache, size_t blocks) {
+        lock_guard<mutex> guard(lock);
+        for (; blocks > 0 && cache.head; blocks--) {
+            void* block = cache.head;
+            cache.head = next(block);
+            cache.count--;
+            next(block) = freeList;
+            freeList = block;
+        }
+    }
+    
+public:
+    explicit SlabPool(size_t blockSize) : blockSize(max(blockSize, sizeof(void*))) {}
+    SlabPool(const SlabPool&) = delete;
+    SlabPool& operator=(const SlabPool&) = delete;
+    
+    // This thread's cache for blocks of BlockSize bytes. The pools are never
+    // destroyed, so objects may be released from any thread at any time.
+    template <size_t BlockSize>
+    static ThreadCache& cacheFor() {
+        static SlabPool* pool = new SlabPool(BlockSize);
+        thread_local ThreadCache cache(*pool);
+        return cache;
+    }
+};
+
+// Allocator over SlabPool for allocate_shared. Single objects (the shared_ptr
+// control block together with the entity) come from the pool; anything else
+// falls through to the global heap.
+template <typename T>
+struct SlabAllocator {
+    using value_type = T;
+    static_assert(alignof(T) <= alignof(max_align_t), "SlabAllocator supports default alignment only");
+    static constexpr size_t blockSize =
+        (sizeof(T) + alignof(max_align_t) - 1) / alignof(max_align_t) * alignof(max_align_t);
+    
+    SlabAllocator() = default;
+    template <typename U>
+    SlabAllocator(const SlabAllocator<U>&) {}
+    
+    T* allocate(size_t n) {
+        if (n != 1) return static_cast<T*>(::operator new(n * sizeof(T)));
+        return static_cast<T*>(SlabPool::cacheFor<blockSize>().allocate());
+    }
+    
+    void deallocate(T* pointer, size_t n) {
+        if (n != 1) {
+            ::operator delete(pointer);
+        } else {
+            SlabPool::cacheFor<blockSize>().deallocate(pointer);
+        }
+    }
+    
+    template <typename U>
+    bool operator==(const SlabAllocator<U>&) const { return true; }
+    template <typename U>
+    bool operator!=(const SlabAllocator<U>&) const { return false; }
+};
+
+// Every entity object is created here. Text fields stay std::string: IDs,
+// names, phone numbers and codes fit its 15-character inline buffer, so
+// typical rows make no string allocations of their own.
+namespace EntityPool {
+    template <typename T, typename... Args>
+    shared_ptr<T> create(Args&&... args) {
+        return allocate_shared<T>(SlabAllocator<T>(), forward<Args>(args)...);
+    }
+    
+    // Owning pointer for secondary blocks of an entity. These always come
+    // from the pools.
+    template <typename T>
+    struct SlabDelete {
+        void operator()(T* pointer) const {
+            pointer->~T();
+            SlabAllocator<T>().deallocate(pointer, 1);
+        }
+    };
+    
+    template <typename T>
+    using UniquePtr = unique_ptr<T, SlabDelete<T>>;
+    
+    template <typename T, typename... Args>
+    UniquePtr<T> createUnique(Args&&... args) {
+        T* pointer = SlabAllocator<T>().allocate(1);
+        try {
+            new (pointer) T(forward<Args>(args)...);
+        } catch (...) {
+            SlabAllocator<T>().deallocate(pointer, 1);
+            throw;
+        }
+        return UniquePtr<T>(pointer);
+    }
+}
+
+// One bit per calendar day, stored as 64-day words starting at baseWord.
+// A year of availability costs under 48 bytes of bitmap.
+class AvailabilityCalendar {
+private:
+    int32_t baseWord = 0;
+    vector<uint64_t> words;
+    
+    static int32_t wordOf(Date day) {
+        int32_t n = day.dayNumber();
+        return (n >= 0) ? n / 64 : -((-n + 63) / 64);
+    }
+    
+    static int bitOf(Date day) {
+        return static_cast<int>(day.dayNumber() - wordOf(day) * 64);
+    }
+    
+    // Grows the bitmap so that words [first, last] exist
+    void cover(int32_t first, int32_t last) {
+        if (words.empty()) {
+            baseWord = first;
+            words.assign(static_cast<size_t>(last - first + 1), 0);
+            return;
+        }
+        if (first < baseWord) {
+            words.insert(words.begin(), static_cast<size_t>(baseWord - first), 0);
+            baseWord = first;
+        }
+        int32_t end = baseWord + static_cast<int32_t>(words.size());
+        if (last >= end) {
+            words.resize(words.size() + static_cast<size_t>(last - end + 1), 0);
+        }
+    }
+    
+    // Drops all-zero words from both ends
+    void trim() {
+        size_t leading = 0;
+        while (leading < words.size() && words[leading] == 0) leading++;
+        if (leading == words.size()) {
+            words.clear();
+            baseWord = 0;
+            return;
+        }
+        while (words.back() == 0) words.pop_back();
+        words.erase(words.begin(), words.begin() + static_cast<ptrdiff_t>(leading));
+        baseWord += static_cast<int32_t>(leading);
+    }
+    
+    template <typename WordOp>
+    void applyRange(Date from, Date to, WordOp op) {
+        int32_t firstWord = wordOf(from), lastWord = wordOf(to);
+        for (int32_t w = firstWord; w <= lastWord; w++) {
+            int low = (w == firstWord) ? bitOf(from) : 0;
+            int high = (w == lastWord) ? bitOf(to) : 63;
+            op(words[static_cast<size_t>(w - baseWord)], BitUtil::rangeMask(low, high));
+        }
+    }
+    
+public:
+    bool empty() const { return words.empty(); }
+    
+    bool test(Date day) const {
+        int32_t w = wordOf(day) - baseWord;
+        if (w < 0 || w >= static_cast<int32_t>(words.size())) return false;
+        return (words[static_cast<size_t>(w)] >> bitOf(day)) & 1;
+    }
+    
+    void set(Date day) { setRange(day, day); }
+    void clear(Date day) { clearRange(day, day); }
+    
+    void setRange(Date from, Date to) {
+        if (to < from) return;
+        cover(wordOf(from), wordOf(to));
+        applyRange(from, to, [](uint64_t& word, uint64_t mask) { word |= mask; });
+    }
+    
+    void clearRange(Date from, Date to) {
+        if (to < from || words.empty()) return;
+        Date first(baseWord * 64);
+        Date last((baseWord + static_cast<int32_t>(words.size())) * 64 - 1);
+        if (from < first) from = first;
+        if (to > last) to = last;
+        if (to < from) return;
+        applyRange(from, to, [](uint64_t& word, uint64_t mask) { word &= ~mask; });
+        trim();
+    }
+    
+    // First set day on or after `from`; false if there is none
+    bool nextSetDay(Date from, Date& found) const {
+        int32_t w = wordOf(from) - baseWord;
+        uint64_t mask = ~0ULL;
+        if (w < 0) {
+            w = 0;
+        } else {
+            mask = ~0ULL << bitOf(from);
+        }
+        for (; w < static_cast<int32_t>(words.size()); w++) {
+            uint64_t word = words[static_cast<size_t>(w)] & mask;
+            if (word) {
+                found = Date((baseWord + w) * 64 + BitUtil::lowestSetBit(word));
+                return true;
+            }
+            mask = ~0ULL;
+        }
+        return false;
+    }
+    
+    size_t count() const {
+        size_t total = 0;
+        for (uint64_t word : words) total += static_cast<size_t>(BitUtil::popCount(word));
+        return total;
+    }
+    
+    // Visits set days in ascending order
+    template <typename Callback>
+    void forEachDay(Callback onDay) const {
+        for (size_t w = 0; w < words.size(); w++) {
+            for (uint64_t word = words[w]; word; word &= word - 1) {
+                onDay(Date((baseWord + static_cast<int32_t>(w)) * 64 + BitUtil::lowestSetBit(word)));
+            }
+        }
+    }
+    
+    // Visits maximal runs of consecutive set days as [first, last]
+    template <typename Callback>
+    void forEachRun(Callback onRun) const {
+        bool open = false;
+        Date runStart, previous;
+        forEachDay([&](Date day) {
+            if (open && day == previous.addDays(1)) {
+                previous = day;
+                return;
+            }
+            if (open) onRun(runStart, previous);
+            runStart = previous = day;
+            open = true;
+        });
+        if (open) onRun(runStart, previous);
+    }
+    
+    void writeBinary(BinaryWriter& out) const {
+        out.writeFixed(baseWord);
+        out.writeFixed(static_cast<uint32_t>(words.size()));
+        for (uint64_t word : words) out.writeFixed(word);
+    }
+    
+    void readBinary(BinaryReader& in) {
+        baseWord = in.readFixed<int32_t>();
+        uint32_t wordCount = in.readFixed<uint32_t>();
+        words.resize(wordCount);
+        for (auto& word : words) word = in.readFixed<uint64_t>();
+    }
+};
+
+// Weekly availability rule: the selected weekdays between two dates.
+// Include rules add availability; Exclude rules (exceptions, holidays)
+// remove availability that include rules would otherwise grant.
+// Serialized as <+|-><weekday mask>:<from>:<to>, e.g. +MTWTF__:2026-01-05:2026-12-31
+struct AvailabilityRule {
+    enum class Kind : uint8_t { Include, Exclude };
+    
+    static const uint8_t allWeekdays = 0x7F; // bit 0 = Monday ... bit 6 = Sunday
+    
+    Kind kind = Kind::Include;
+    uint8_t weekdays = allWeekdays;
+    Date from;
+    Date to;
+    
+    bool covers(Date day) const {
+        return day >= from && day <= to && ((weekdays >> day.weekday()) & 1);
+    }
+    
+    // First covered day on or after `day`
+    bool nextCoveredDay(Date day, Date& found) const {
+        if (weekdays == 0) return false;
+        Date candidate = (day < from) ? from : day;
+        for (int i = 0; i < 7 && candidate <= to; i++, candidate = candidate.addDays(1)) {
+            if ((weekdays >> candidate.weekday()) & 1) {
+                found = candidate;
+                return true;
+            }
+        }
+        return false;
+    }
+    
+    string weekdayMask() const {
+        static const char letters[] = "MTWTFSS";
+        string mask(7, '_');
+        for (int i = 0; i < 7; i++) {
+            if ((weekdays >> i) & 1) mask[i] = letters[i];
+        }
+        return mask;
+    }
+    
+    string serialize() const {
+        return string(1, kind == Kind::Include ? '+' : '-') + weekdayMask() + ":" +
+               from.toString() + ":" + to.toString();
+    }
+    
+    static AvailabilityRule parse(string_view text) {
+        if (text.size() != 30 || (text[0] != '+' && text[0] != '-') || text[8] != ':' || text[19] != ':') {
+            throw runtime_error("Invalid availability rule format");
+        }
+        
+        AvailabilityRule rule;
+        rule.kind = (text[0] == '+') ? Kind::Include : Kind::Exclude;
+        rule.weekdays = 0;
+        for (int i = 0; i < 7; i++) {
+            if (text[1 + i] != '_') rule.weekdays |= static_cast<uint8_t>(1 << i);
+        }
+        rule.from = Date::parse(text.substr(9, 10));
+        rule.to = Date::parse(text.substr(20, 10));
+        return rule;
+    }
+    
+    // Parses weekday names such as "Mon Wed Fri" or "mon,tue"; "all" selects every day
+    static bool parseWeekdays(const string& text, uint8_t& mask) {
+        static const char* names[] = {"mon", "tue", "wed", "thu", "fri", "sat", "sun"};
+        mask = 0;
+        
+        string normalized = text;
+        replace(normalized.begin(), normalized.end(), ',', ' ');
+        
+        string token;
+        istringstream tokens(normalized);
+        while (tokens >> token) {
+            for (char& c : token) c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+            if (token == "all") {
+                mask = allWeekdays;
+                continue;
+            }
+            
+            bool matched = false;
+            for (int i = 0; i < 7; i++) {
+                if (token.size() >= 3 && token.compare(0, 3, names[i]) == 0) {
+                    mask |= static_cast<uint8_t>(1 << i);
+                    matched = true;
+                }
+            }
+            if (!matched) return false;
+        }
+        return mask != 0;
+    }
+};
+
+// Each entity lists its columns once, in CSV order, in a constexpr
+// `schema()` of Schema::Field values. The CSV and snapshot codecs are
+// generated from that list: they parse every column straight into its
+// member, and the two formats cannot drift apart.
+namespace Schema {
+    // Tag for the constructors that leave an entity for the decoders to fill
+    struct Blank {};
+    constexpr Blank blank{};
+    
+    // One column: a codec plus a captureless accessor returning a reference
+    // to the member it reads and writes. Optional columns may be missing at
+    // the end of rows written by older versions.
+    template <typename ColumnCodec, typename Access>
+    struct Field {
+        using Codec = ColumnCodec;
+        const char* name;
+        Access access;
+        bool optional;
+    };
+    
+    template <typename Codec, typename Access>
+    constexpr Field<Codec, Access> field(const char* name, Access access, bool optional = false) {
+        return Field<Codec, Access>{name, access, optional};
+    }
+    
+    template <typename Columns>
+    constexpr bool optionalColumnsLast(const Columns& columns) {
+        bool seenOptional = false;
+        bool valid = true;
+        apply([&](const auto&... column) {
+            ((valid = valid && (column.optional || !seenOptional), seenOptional = seenOptional || column.optional), ...);
+        }, columns);
+        return valid;
+    }
+    
+    constexpr bool sameName(const char* a, const char* b) {
+        while (*a && *a == *b) {
+            a++;
+            b++;
+        }
+        return *a == *b;
+    }
+    
+    template <typename Columns>
+    constexpr bool uniqueColumnNames(const Columns& columns) {
+        const char* names[tuple_size<Columns>::value] = {};
+        size_t count = 0;
+        apply([&](const auto&... column) { ((names[count++] = column.name), ...); }, columns);
+        for (size_t i = 0; i < count; i++) {
+            for (size_t j = i + 1; j < count; j++) {
+                if (sameName(names[i], names[j])) return false;
+            }
+        }
+        return true;
+    }
+    
+    template <typename Entity>
+    void checkColumns() {
+        static_assert(tuple_size<decltype(Entity::schema())>::value > 0, "a schema needs at least one column");
+        static_assert(optionalColumnsLast(Entity::schema()), "optional columns must follow every required column");
+        static_assert(uniqueColumnNames(Entity::schema()), "column names must be unique");
+    }
+    
+    template <typename Column, typename Entity>
+    void parseColumn(CsvUtil::FieldReader& fields, const Column& column, Entity& entity) {
+        if (!fields.hasMore()) {
+            if (!column.optional) {
+                throw runtime_error(string("Invalid ") + Entity::schemaName + " data format");
+            }
+            return;
+        }
+        Column::Codec::parse(fields.next(), column.access(entity));
+    }
+    
+    // Columns past the last one in the schema are ignored
+    template <typename Entity>
+    void parseCsv(string_view row, Entity& entity) {
+        checkColumns<Entity>();
+        CsvUtil::FieldReader fields(row);
+        apply([&](const auto&... column) {
+            (parseColumn(fields, column, entity), ...);
+        }, Entity::schema());
+    }
+    
+    template <typename Column, typename Entity>
+    void formatColumn(string& row, bool first, const Column& column, const Entity& entity) {
+        if (!first) row.push_back(',');
+        size_t start = row.size();
+        Column::Codec::format(column.access(entity), row);
+        CsvUtil::quoteField(row, start);
+    }
+    
+    template <typename Entity>
+    string formatCsv(const Entity& entity) {
+        checkColumns<Entity>();
+        string row;
+        row.reserve(96);
+        bool first = true;
+        apply([&](const auto&... column) {
+            ((formatColumn(row, first, column, entity), first = false), ...);
+        }, Entity::schema());
+        return row;
+    }
+    
+    template <typename Entity>
+    void writeBinary(const Entity& entity, BinaryWriter& out) {
+        checkColumns<Entity>();
+        apply([&](const auto&... column) {
+            (decay_t<decltype(column)>::Codec::write(column.access(entity), out), ...);
+        }, Entity::schema());
+    }
+    
+    template <typename Entity>
+    void readBinary(BinaryReader& in, Entity& entity) {
+        checkColumns<Entity>();
+        apply([&](const auto&... column) {
+            (decay_t<decltype(column)>::Codec::read(in, column.access(entity)), ...);
+        }, Entity::schema());
+    }
+    
+    // Column codecs: parse/format the CSV text, write/read the snapshot form
+    struct Text {
+        static void parse(string_view text, string& value) { value.assign(text.data(), text.size()); }
+        static void format(const string& value, string& out) { out += value; }
+        static void write(const string& value, BinaryWriter& out) { out.writeString(value); }
+        static void read(BinaryReader& in, string& value) { in.readString(value); }
+    };
+    
+    struct DateValue {
+        static void parse(string_view text, Date& value) { value = Date::parse(text); }
+        static void format(Date value, string& out) { out += value.toString(); }
+        static void write(Date value, BinaryWriter& out) { out.writeFixed(value.dayNumber()); }
+        static void read(BinaryReader& in, Date& value) { value = Date(in.readFixed<int32_t>()); }
+    };
+    
+    // '|'-joined days; the snapshot keeps the bitmap
+    struct DayList {
+        static void parse(string_view text, AvailabilityCalendar& calendar) {
+            CsvUtil::forEachListItem(text, [&](string_view day) {
+                calendar.set(Date::parse(day));
+            });
+        }
+        static void format(const AvailabilityCalendar& calendar, string& out) {
+            bool first = true;
+            calendar.forEachDay([&](Date day) {
+                if (!first) out.push_back('|');
+                out += day.toString();
+                first = false;
+            });
+        }
+        static void write(const AvailabilityCalendar& calendar, BinaryWriter& out) { calendar.writeBinary(out); }
+        static void read(BinaryReader& in, AvailabilityCalendar& calendar) { calendar.readBinary(in); }
+    };
+    
+    // '|'-joined AvailabilityRule::serialize forms
+    struct RuleList {
+        static void parse(string_view text, vector<AvailabilityRule>& rules) {
+            CsvUtil::forEachListItem(text, [&](string_view rule) {
+                rules.push_back(AvailabilityRule::parse(rule));
+            });
+        }
+        static void format(const vector<AvailabilityRule>& rules, string& out) {
+            for (size_t i = 0; i < rules.size(); i++) {
+                if (i > 0) out.push_back('|');
+                out += rules[i].serialize();
+            }
+        }
+        static void write(const vector<AvailabilityRule>& rules, BinaryWriter& out) {
+            out.writeFixed(static_cast<uint32_t>(rules.size()));
+            for (const auto& rule : rules) {
+                out.writeFixed(static_cast<uint8_t>(rule.kind));
+                out.writeFixed(rule.weekdays);
+                out.writeFixed(rule.from.dayNumber());
+                out.writeFixed(rule.to.dayNumber());
+            }
+        }
+        static void read(BinaryReader& in, vector<AvailabilityRule>& rules) {
+            uint32_t count = in.readFixed<uint32_t>();
+            rules.clear();
+            rules.reserve(count);
+            for (uint32_t i = 0; i < count; i++) {
+                AvailabilityRule rule;
+                rule.kind = static_cast<AvailabilityRule::Kind>(in.readFixed<uint8_t>());
+                rule.weekdays = in.readFixed<uint8_t>();
+                rule.from = Date(in.readFixed<int32_t>());
+                rule.to = Date(in.readFixed<int32_t>());
+                rules.push_back(rule);
+            }
+        }
+    };
+}
+
+// Where a patient's history lives in the MedicalHistoryStore
+struct HistoryRef {
+    int64_t last = -1;      // offset of the newest entry
+    uint32_t count = 0;
+};
+
+// Append-only medical history file. Each line is
+// "<offset of the patient's previous entry>,<patient ID>,<entry>", so a
+// patient's entries form a backward chain and the patient record only has
+// to keep the newest offset and the entry count.
+class MedicalHistoryStore {
+private:
+    string path;
+    FILE* file = nullptr;
+    int64_t endOffset = 0;
+    mutex fileLock;   // sync() may run on the persistence worker
+    
+    void open() {
+        if (uintmax_t dropped = FileUtil::trimToLastLine(path)) {
+            cerr << "Warning: dropped an incomplete record (" << dropped << " bytes) at the end of " << path << endl;
+        }
+        file = fopen(path.c_str(), "ab");
+        if (!file) {
+            throw runtime_error("Could not open medical history file " + path);
+        }
+        fseek(file, 0, SEEK_END);
+        endOffset = ftell(file);
+    }
+    
+    // One record per line, so line breaks and backslashes in the entry are
+    // written as the escapes \n, \r and \\ (a doubled backslash).
+    static string escapeEntry(const string& entry) {
+        string out;
+        out.reserve(entry.size());
+        for (char c : entry) {
+            switch (c) {
+                case '\n': out += "\\n"; break;
+                case '\r': out += "\\r"; break;
+                case '\\': out += "\\\\"; break;
+                default: out += c;
+            }
+        }
+        return out;
+    }
+    
+    // Any other backslash is kept as written
+    static string_view unescapeEntry(string_view entry, string& buffer) {
+        if (entry.find('\\') == string_view::npos) return entry;
+        buffer.clear();
+        for (size_t i = 0; i < entry.size(); i++) {
+            char c = entry[i];
+            if (c == '\\' && i + 1 < entry.size()) {
+                char next = entry[i + 1];
+                if (next == 'n' || next == 'r' || next == '\\') {
+                    buffer += (next == 'n') ? '\n' : (next == 'r') ? '\r' : '\\';
+                    i++;
+                    continue;
+                }
+            }
+            buffer += c;
+        }
+        return buffer;
+    }
+    
+    // Splits a record into its previous offset, patient ID and entry text
+    static bool parseRecord(string_view line, int64_t& previous, string_view& patientId, string_view& entry) {
+        size_t first = line.find(',');
+        size_t second = (first == string_view::npos) ? string_view::npos : line.find(',', first + 1);
+        if (second == string_view::npos) return false;
+        
+        string_view offsetText = line.substr(0, first);
+        bool negative = !offsetText.empty() && offsetText[0] == '-';
+        if (negative) offsetText.remove_prefix(1);
+        if (offsetText.empty()) return false;
+        previous = 0;
+        for (char c : offsetText) {
+            if (!isdigit(static_cast<unsigned char>(c))) return false;
+            previous = previous * 10 + (c - '0');
+        }
+        if (negative) previous = -previous;
+        
+        patientId = line.substr(first + 1, second - first - 1);
+        entry = line.substr(second + 1);
+        return true;
+    }
+    
+public:
+    explicit MedicalHistoryStore(const string& path) : path(path) {}
+    
+    MedicalHistoryStore(const MedicalHistoryStore&) = delete;
+    MedicalHistoryStore& operator=(const MedicalHistoryStore&) = delete;
+    
+    ~MedicalHistoryStore() {
+        if (file) {
+            fclose(file);
+        }
+    }
+    
+    // Visible to read() on return; durable only if `durable` is set. Otherwise
+    // sync() must run before anything that stores the returned reference
+    // reaches the disk.
+    HistoryRef append(const string& patientId, HistoryRef previous, const string& entry, bool durable = true) {
+        lock_guard<mutex> guard(fileLock);
+        if (!file) {
+            open();
+        }
+        string record = to_string(previous.last) + "," + patientId + "," + escapeEntry(entry) + "\n";
+        if (fwrite(record.data(), 1, record.size(), file) != record.size()) {
+            throw runtime_error("Could not write to medical history file " + path);
+        }
+        if (!(durable ? FileUtil::syncToDisk(file) : fflush(file) == 0)) {
+            throw runtime_error("Could not write to medical history file " + path);
+        }
+        
+        HistoryRef ref{endOffset, previous.count + 1};
+        endOffset += static_cast<int64_t>(record.size());
+        return ref;
+    }
+    
+    void sync() {
+        lock_guard<mutex> guard(fileLock);
+        if (file && !FileUtil::syncToDisk(file)) {
+            throw runtime_error("Could not sync medical history file " + path);
+        }
+    }
+    
+    // Follows the chain back from ref.last; entries come back oldest first
+    vector<string> read(const string& patientId, HistoryRef ref) const {
+        vector<string> entries(ref.count);
+        if (ref.count == 0) return entries;
+        
+        ifstream in(path, ios::binary);
+        if (!in) {
+            throw runtime_error("Could not open medical history file " + path);
+        }
+        
+        string line, buffer;
+        int64_t offset = ref.last;
+        for (uint32_t i = ref.count; i-- > 0; ) {
+            if (offset < 0 || !in.seekg(offset) || !getline(in, line)) {
+                throw runtime_error("Missing medical history record for patient " + patientId);
+            }
+            string_view recordPatient, entry;
+            if (!parseRecord(line, offset, recordPatient, entry) || recordPatient != patientId) {
+                throw runtime_error("Corrupt medical history record for patient " + patientId);
+            }
+            entries[i] = string(unescapeEntry(entry, buffer));
+        }
+        return entries;
+    }
+    
+    // Calls onRecord(offset, previousOffset, patientId, entry) for every record, in file order
+    template <typename Callback>
+    void scan(Callback onRecord) const {
+        MappedFile mapped(path);
+        if (!mapped.isOpen()) return;
+        
+        string_view text = mapped.view();
+        string buffer;
+        CsvUtil::forEachLine(text, [&](string_view line) {
+            int64_t previous;
+            string_view patientId, entry;
+            if (parseRecord(line, previous, patientId, entry)) {
+                onRecord(static_cast<int64_t>(line.data() - text.data()), previous, patientId, unescapeEntry(entry, buffer));
+            }
+        });
+    }
+};
+
+class Person {
+protected:
+    string id;
+    string name;
+    string gender;
+    string phoneNumber;
+    
+    Person() = default;
+    
+    // Leading columns of the patient and doctor schemas
+    static constexpr auto personColumns() {
+        return make_tuple(
+            Schema::field<Schema::Text>("id", [](auto& person) -> auto& { return person.id; }),
+            Schema::field<Schema::Text>("name", [](auto& person) -> auto& { return person.name; }),
+            Schema::field<Schema::Text>("gender", [](auto& person) -> auto& { return person.gender; }),
+            Schema::field<Schema::Text>("phone", [](auto& person) -> auto& { return person.phoneNumber; })
+        );
+    }
+    
+public:
+    Person(string id, string name, string gender, string phoneNumber)
+        : id(move(id)), name(move(name)), gender(move(gender)), phoneNumber(move(phoneNumber)) {}
+    
+    virtual ~Person() = default;
+    
+    string getId() const { return id; }
+    string getName() const { return name; }
+    string getGender() const { return gender; }
+    string getPhoneNumber() const { return phoneNumber; }
+    
+    void setName(const string& name) { this->name = name; }
+    void setGender(const string& gender) { this->gender = gender; }
+    void setPhoneNumber(const string& phone) { this->phoneNumber = phone; }
+    
+    virtual string serialize() const = 0;
+    
+    virtual void display() const {
+        cout << "ID: " << id << "\n";
+        cout << "Name: " << name << "\n";
+        cout << "Gender: " << gender << "\n";
+        cout << "Phone: " << phoneNumber << "\n";
+    }
+};
+
+class Patient : public Person {
+private:
+    // Fields read only when a single patient is shown, saved or given a
+    // history entry. They sit in their own slab block, so rosters and joins
+    // that read only the identity fields in Person touch less memory.
+    //
+    // History normally lives in the MedicalHistoryStore and is read on first
+    // use. Rows written before the store existed carry it inline; those
+    // entries move into the store when one is attached.
+    struct Details {
+        Date dateOfBirth;
+        string bloodType;
+        string insuranceInfo;
+        MedicalHistoryStore* historyStore = nullptr;
+        HistoryRef historyRef;
+        bool historyInline = false;
+        bool historyLoaded = true;
+        vector<string> medicalHistory;
+        
+        Details() = default;
+        Details(Date dateOfBirth, string bloodType, string insuranceInfo)
+            : dateOfBirth(dateOfBirth), bloodType(move(bloodType)), insuranceInfo(move(insuranceInfo)) {}
+    };
+    
+    // The history column is "@<offset>:<count>" for store-backed history, or
+    // the legacy '|'-joined entries while they are still inline
+    struct HistoryColumn {
+        static void parse(string_view text, Details& details) {
+            if (!text.empty() && text[0] == '@') {
+                char* end = nullptr;
+                string digits(text.substr(1));
+                const char* start = digits.c_str();
+                errno = 0;
+                long long last = strtoll(start, &end, 10);
+                if (end == start || *end != ':' || !isdigit(static_cast<unsigned char>(end[1]))) {
+                    throw runtime_error("Invalid medical history reference");
+                }
+                unsigned long count = strtoul(end + 1, &end, 10);
+                if (*end != '\0' || errno == ERANGE || count > numeric_limits<uint32_t>::max()) {
+                    throw runtime_error("Invalid medical history reference");
+                }
+                details.historyRef = HistoryRef{last, static_cast<uint32_t>(count)};
+                details.historyLoaded = (count == 0);
+            } else {
+                CsvUtil::forEachListItem(text, [&](string_view entry) {
+                    details.medicalHistory.emplace_back(entry);
+                });
+                details.historyInline = !details.medicalHistory.empty();
+            }
+        }
+        
+        static void format(const Details& details, string& out) {
+            if (details.historyInline) {
+                for (size_t i = 0; i < details.medicalHistory.size(); i++) {
+                    if (i > 0) out.push_back('|');
+                    out += details.medicalHistory[i];
+                }
+            } else if (details.historyRef.count > 0) {
+                out += '@';
+                out += to_string(details.historyRef.last);
+                out += ':';
+                out += to_string(details.historyRef.count);
+            }
+        }
+        
+        static void write(const Details& details, BinaryWriter& out) {
+            out.writeFixed(details.historyInline);
+            if (details.historyInline) {
+                out.writeFixed(static_cast<uint32_t>(details.medicalHistory.size()));
+                for (const auto& entry : details.medicalHistory) {
+                    out.writeString(entry);
+                }
+            } else {
+                out.writeFixed(details.historyRef.last);
+                out.writeFixed(details.historyRef.count);
+            }
+        }
+        
+        static void read(BinaryReader& in, Details& details) {
+            details.historyInline = in.readFixed<bool>();
+            if (details.historyInline) {
+                uint32_t historyCount = in.readFixed<uint32_t>();
+                details.medicalHistory.resize(historyCount);
+                for (auto& entry : details.medicalHistory) {
+                    in.readString(entry);
+                }
+            } else {
+                details.historyRef.last = in.readFixed<int64_t>();
+                details.historyRef.count = in.readFixed<uint32_t>();
+                details.historyLoaded = (details.historyRef.count == 0);
+            }
+        }
+    };
+    
+    EntityPool::UniquePtr<Details> details; // Loaded lazily through const accessors
+    
+public:
+    static constexpr const char* schemaName = "patient";
+    static constexpr auto schema() {
+        return tuple_cat(personColumns(), make_tuple(
+            Schema::field<Schema::DateValue>("dateOfBirth", [](auto& patient) -> auto& { return patient.details->dateOfBirth; }),
+            Schema::field<Schema::Text>("bloodType", [](auto& patient) -> auto& { return patient.details->bloodType; }),
+            Schema::field<HistoryColumn>("medicalHistory", [](auto& patient) -> auto& { return *patient.details; }),
+            Schema::field<Schema::Text>("insurance", [](auto& patient) -> auto& { return patient.details->insuranceInfo; })
+        ));
+    }
+    
+    explicit Patient(Schema::Blank) : details(EntityPool::createUnique<Details>()) {}
+    
+    Patient(string id, string name, string gender, 
+            string phoneNumber, Date dateOfBirth, 
+            string bloodType, string insuranceInfo)
+        : Person(move(id), move(name), move(gender), move(phoneNumber)), 
+          details(EntityPool::createUnique<Details>(dateOfBirth, move(bloodType), move(insuranceInfo))) {}
+    
+    Date getDateOfBirth() const { return details->dateOfBirth; }
+    string getBloodType() const { return details->bloodType; }
+    const vector<string>& getMedicalHistory() const {
+        if (!details->historyLoaded) {
+            details->medicalHistory = details->historyStore->read(id, details->historyRef);
+            details->historyLoaded = true;
+        }
+        return details->medicalHistory;
+    }
+    
+    size_t getHistoryCount() const {
+        return details->historyInline ? details->medicalHistory.size() : details->historyRef.count;
+    }
+    HistoryRef getHistoryRef() const { return details->historyRef; }
+    
+    // Returns true if inline entries were moved into the store, which
+    // changes how the patient serializes
+    bool attachHistoryStore(MedicalHistoryStore* store) {
+        details->historyStore = store;
+        if (!details->historyInline) return false;
+        
+        for (const auto& entry : details->medicalHistory) {
+            details->historyRef = store->append(id, details->historyRef, entry, false);
+        }
+        details->historyInline = false;
+        return true;
+    }
+    string getInsuranceInfo() const { return details->insuranceInfo; }
+    
+    void setDateOfBirth(Date dob) { details->dateOfBirth = dob; }
+    void setBloodType(const string& bt) { details->bloodType = bt; }
+    void setInsuranceInfo(const string& info) { details->insuranceInfo = info; }
+    
+    // Returns the stored entry, date stamp included
+    string addMedicalHistoryEntry(const string& entry) {
+        string stamped = DateUtil::getCurrentDate() + ": " + entry;
+        if (details->historyStore) {
+            // The persistence worker syncs the store before writing the journal record
+            details->historyRef = details->historyStore->append(id, details->historyRef, stamped, false);
+            if (details->historyLoaded) {
+                details->medicalHistory.push_back(stamped);
+            }
+        } else {
+            details->historyInline = true;
+            details->medicalHistory.push_back(stamped);
+        }
+        return stamped;
+    }
+    
+    string serialize() const override {
+        return Schema::formatCsv(*this);
+    }
+    
+    void display() const override {
+        Person::display();
+        cout << "Date of Birth: " << details->dateOfBirth << "\n";
+        cout << "Blood Type: " << details->bloodType << "\n";
+        cout << "Insurance: " << details->insuranceInfo << "\n";
+        
+        cout << "Medical History:\n";
+        if (getHistoryCount() == 0) {
+            cout << "  No records available\n";
+        } else {
+            for (const auto& entry : getMedicalHistory()) {
+                cout << "  " << entry << "\n";
+            }
+        }
+    }
+    
+    void writeBinary(BinaryWriter& out) const {
+        Schema::writeBinary(*this, out);
+    }
+    
+    static shared_ptr<Patient> readBinary(BinaryReader& in) {
+        auto patient = EntityPool::create<Patient>(Schema::blank);
+        Schema::readBinary(in, *patient);
+        return patient;
+    }
+    
+    static shared_ptr<Patient> deserialize(string_view data) {
+        auto patient = EntityPool::create<Patient>(Schema::blank);
+        Schema::parseCsv(data, *patient);
+        return patient;
+    }
+};
+
+class Doctor : public Person {
+private:
+    string specialization;
+    string licenseNumber;
+    AvailabilityCalendar availability; // individually added days
+    vector<AvailabilityRule> availabilityRules;
+    string departmentId;
+    
+    bool coveredByRule(Date day, AvailabilityRule::Kind kind) const {
+        for (const auto& rule : availabilityRules) {
+            if (rule.kind == kind && rule.covers(day)) return true;
+        }
+        return false;
+    }
+    
+    bool availableByRule(Date day) const {
+        return coveredByRule(day, AvailabilityRule::Kind::Include) &&
+               !coveredByRule(day, AvailabilityRule::Kind::Exclude);
+    }
+    
+    // Earliest day on or after `from` granted by an include rule and not excluded
+    bool nextRuleDay(Date from, Date& found) const {
+        Date day = from;
+        while (true) {
+            bool any = false;
+            Date earliest;
+            for (const auto& rule : availabilityRules) {
+                Date covered;
+                if (rule.kind == AvailabilityRule::Kind::Include && rule.nextCoveredDay(day, covered) &&
+                    (!any || covered < earliest)) {
+                    earliest = covered;
+                    any = true;
+                }
+            }
+            if (!any) return false;
+            
+            const AvailabilityRule* blocking = nullptr;
+            for (const auto& rule : availabilityRules) {
+                if (rule.kind == AvailabilityRule::Kind::Exclude && rule.covers(earliest)) {
+                    blocking = &rule;
+                    break;
+                }
+            }
+            if (!blocking) {
+                found = earliest;
+                return true;
+            }
+            // Skip a whole holiday block at once
+            day = (blocking->weekdays == AvailabilityRule::allWeekdays) ? blocking->to.addDays(1)
+                                                                         : earliest.addDays(1);
+        }
+    }
+    
+    // Hospital keys reverse indexes on these; change them through
+    // Hospital::setDoctorSpecialization and setDoctorDepartment
+    friend class Hospital;
+    void setSpecialization(const string& spec) { this->specialization = spec; }
+    void setDepartmentId(const string& deptId) { this->departmentId = deptId; }
+    
+public:
+    static constexpr const char* schemaName = "doctor";
+    static constexpr auto schema() {
+        return tuple_cat(personColumns(), make_tuple(
+            Schema::field<Schema::Text>("specialization", [](auto& doctor) -> auto& { return doctor.specialization; }),
+            Schema::field<Schema::Text>("license", [](auto& doctor) -> auto& { return doctor.licenseNumber; }),
+            Schema::field<Schema::DayList>("availableDays", [](auto& doctor) -> auto& { return doctor.availability; }),
+            Schema::field<Schema::Text>("department", [](auto& doctor) -> auto& { return doctor.departmentId; }),
+            // Absent in files written before weekly rules existed
+            Schema::field<Schema::RuleList>("availabilityRules", [](auto& doctor) -> auto& { return doctor.availabilityRules; }, true)
+        ));
+    }
+    
+    explicit Doctor(Schema::Blank) {}
+    
+    Doctor(string id, string name, string gender, 
+           string phoneNumber, string specialization, 
+           string licenseNumber, string departmentId)
+        : Person(move(id), move(name), move(gender), move(phoneNumber)), specialization(move(specialization)), 
+          licenseNumber(move(licenseNumber)), departmentId(move(departmentId)) {}
+    
+    string getSpecialization() const { return specialization; }
+    string getLicenseNumber() const { return licenseNumber; }
+    const AvailabilityCalendar& getAvailability() const { return availability; }
+    const vector<AvailabilityRule>& getAvailabilityRules() const { return availabilityRules; }
+    string getDepartmentId() const { return departmentId; }
+    
+    void setLicenseNumber(const string& license) { this->licenseNumber = license; }
+    
+    vector<Date> getAvailableDays() const {
+        vector<Date> days;
+        availability.forEachDay([&](Date day) { days.push_back(day); });
+        return days;
+    }
+    
+    bool hasAvailability() const {
+        if (!availability.empty()) return true;
+        for (const auto& rule : availabilityRules) {
+            if (rule.kind == AvailabilityRule::Kind::Include) return true;
+        }
+        return false;
+    }
+    
+    void addAvailableDay(Date day) {
+        availability.set(day);
+    }
+    
+    void removeAvailableDay(Date day) {
+        removeAvailableRange(day, day);
+    }
+    
+    void addAvailableRange(Date from, Date to) {
+        availability.setRange(from, to);
+    }
+    
+    // Clears individually added days. Days still granted by a weekly rule get
+    // an exception, clipped to those days and merged with the all-day
+    // exceptions it touches, so repeated removals do not pile up rules.
+    void removeAvailableRange(Date from, Date to) {
+        availability.clearRange(from, to);
+        Date first;
+        if (!nextRuleDay(from, first) || to < first) return;
+        
+        Date last = first;
+        for (const auto& rule : availabilityRules) {
+            if (rule.kind == AvailabilityRule::Kind::Include && rule.from <= to && last < rule.to) {
+                last = rule.to;
+            }
+        }
+        if (to < last) last = to;
+        
+        AvailabilityRule exception{AvailabilityRule::Kind::Exclude, AvailabilityRule::allWeekdays, first, last};
+        bool merged = true;
+        while (merged) {
+            merged = false;
+            for (auto it = availabilityRules.begin(); it != availabilityRules.end(); ++it) {
+                if (it->kind == AvailabilityRule::Kind::Exclude && it->weekdays == AvailabilityRule::allWeekdays &&
+                    it->from <= exception.to.addDays(1) && exception.from <= it->to.addDays(1)) {
+                    if (it->from < exception.from) exception.from = it->from;
+                    if (exception.to < it->to) exception.to = it->to;
+                    availabilityRules.erase(it);
+                    merged = true;
+                    break;
+                }
+            }
+        }
+        addAvailabilityRule(exception);
+    }
+    
+    void addAvailabilityRule(const AvailabilityRule& rule) {
+        availabilityRules.push_back(rule);
+    }
+    
+    bool removeAvailabilityRule(size_t index) {
+        if (index >= availabilityRules.size()) return false;
+        availabilityRules.erase(availabilityRules.begin() + static_cast<ptrdiff_t>(index));
+        return true;
+    }
+    
+    // Individually added days always count; weekly rules count unless an exclusion covers the day
+    bool isAvailableOn(Date day) const {
+        return availability.test(day) || availableByRule(day);
+    }
+    
+    // Earliest available day on or after `from`
+    bool nextAvailableDay(Date from, Date& found) const {
+        Date explicitDay, ruleDay;
+        bool hasExplicit = availability.nextSetDay(from, explicitDay);
+        bool hasRule = !availabilityRules.empty() && nextRuleDay(from, ruleDay);
+        if (!hasExplicit && !hasRule) return false;
+        
+        if (hasExplicit && hasRule) {
+            found = (explicitDay < ruleDay) ? explicitDay : ruleDay;
+        } else {
+            found = hasExplicit ? explicitDay : ruleDay;
+        }
+        return true;
+    }
+    
+    string serialize() const override {
+        return Schema::formatCsv(*this);
+    }
+    
+    void display() const override {
+        Person::display();
+        cout << "Specialization: " << specialization << "\n";
+        cout << "License Number: " << licenseNumber << "\n";
+        cout << "Department ID: " << departmentId << "\n";
+        
+        cout << "Available Days: ";
+        if (availability.empty()) {
+            cout << "None set\n";
+        } else {
+            bool first = true;
+            availability.forEachRun([&](Date from, Date to) {
+                if (!first) {
+                    cout << ", ";
+                }
+                cout << from;
+                if (to != from) {
+                    cout << " to " << to;
+                }
+                first = false;
+            });
+            cout << "\n";
+        }
+        
+        if (!availabilityRules.empty()) {
+            cout << "Weekly Availability Rules:\n";
+            for (size_t i = 0; i < availabilityRules.size(); i++) {
+                const auto& rule = availabilityRules[i];
+                cout << "  " << (i + 1) << ". "
+                     << (rule.kind == AvailabilityRule::Kind::Include ? "Available " : "Unavailable ")
+                     << rule.weekdayMask() << " from " << rule.from << " to " << rule.to << "\n";
+            }
+        }
+    }
+    
+    void writeBinary(BinaryWriter& out) const {
+        Schema::writeBinary(*this, out);
+    }
+    
+    static shared_ptr<Doctor> readBinary(BinaryReader& in) {
+        auto doctor = EntityPool::create<Doctor>(Schema::blank);
+        Schema::readBinary(in, *doctor);
+        return doctor;
+    }
+    
+    static shared_ptr<Doctor> deserialize(string_view data) {
+        auto doctor = EntityPool::create<Doctor>(Schema::blank);
+        Schema::parseCsv(data, *doctor);
+        return doctor;
+    }
+};
+
+class Department {
+private:
+    string id;
+    string name;
+    string location;
+    
+public:
+    static constexpr const char* schemaName = "department";
+    static constexpr auto schema() {
+        return make_tuple(
+            Schema::field<Schema::Text>("id", [](auto& department) -> auto& { return department.id; }),
+            Schema::field<Schema::Text>("name", [](auto& department) -> auto& { return department.name; }),
+            Schema::field<Schema::Text>("location", [](auto& department) -> auto& { return department.location; })
+        );
+    }
+    
+    explicit Department(Schema::Blank) {}
+    
+    Department(string id, string name, string location)
+        : id(move(id)), name(move(name)), location(move(location)) {}
+    
+    string getId() const { return id; }
+    string getName() const { return name; }
+    string getLocation() const { return location; }
+    
+    void setName(const string& name) { this->name = name; }
+    void setLocation(const string& location) { this->location = location; }
+    
+    string serialize() const {
+        return Schema::formatCsv(*this);
+    }
+    
+    void display() const {
+        cout << "Department ID: " << id << "\n";
+        cout << "Name: " << name << "\n";
+        cout << "Location: " << location << "\n";
+    }
+    
+    void writeBinary(BinaryWriter& out) const {
+        Schema::writeBinary(*this, out);
+    }
+    
+    static shared_ptr<Department> readBinary(BinaryReader& in) {
+        auto department = EntityPool::create<Department>(Schema::blank);
+        Schema::readBinary(in, *department);
+        return department;
+    }
+    
+    static shared_ptr<Department> deserialize(string_view data) {
+        auto department = EntityPool::create<Department>(Schema::blank);
+        Schema::parseCsv(data, *department);
+        return department;
+    }
+};
+
+// Entity IDs are one or two letters followed by digits ("P000123",
+// "DP000004"). A key packs the letters into bits 63..48, the digit count
+// into bits 47..44 and the number into bits 43..0, so keys with the same
+// prefix order like the zero-padded IDs and never collide with each other.
+namespace EntityKey {
+    bool tryEncode(string_view id, uint64_t& key) {
+        size_t letters = 0;
+        while (letters < id.size() && isalpha(static_cast<unsigned char>(id[letters]))) {
+            letters++;
+        }
+        size_t digits = id.size() - letters;
+        if (letters < 1 || letters > 2 || digits < 1 || digits > 13) return false;
+        
+        uint64_t value = 0;
+        for (size_t i = letters; i < id.size(); i++) {
+            if (!isdigit(static_cast<unsigned char>(id[i]))) return false;
+            value = value * 10 + static_cast<uint64_t>(id[i] - '0');
+        }
+        uint64_t prefix = static_cast<uint64_t>(static_cast<unsigned char>(id[0])) << 8;
+        if (letters == 2) prefix |= static_cast<unsigned char>(id[1]);
+        key = prefix << 48 | static_cast<uint64_t>(digits) << 44 | value;
+        return true;
+    }
+    
+    uint64_t encode(string_view id) {
+        uint64_t key;
+        if (!tryEncode(id, key)) {
+            throw runtime_error("Invalid ID: " + string(id));
+        }
+        return key;
+    }
+    
+    string decode(uint64_t key) {
+        string id(1, static_cast<char>(key >> 56));
+        if (char second = static_cast<char>(key >> 48 & 0xFF)) id.push_back(second);
+        size_t digits = static_cast<size_t>(key >> 44 & 0xF);
+        string number = to_string(key & ((1ULL << 44) - 1));
+        id.append(digits > number.size() ? digits - number.size() : 0, '0');
+        return id + number;
+    }
+}
+
+enum class AppointmentStatus : uint8_t { Scheduled, Completed, Cancelled };
+
+namespace AppointmentStatusText {
+    const char* toString(AppointmentStatus status) {
+        switch (status) {
+            case AppointmentStatus::Scheduled: return "Scheduled";
+            case AppointmentStatus::Completed: return "Completed";
+            case AppointmentStatus::Cancelled: return "Cancelled";
+        }
+        return "Scheduled";
+    }
+    
+    AppointmentStatus parse(string_view text) {
+        if (text == "Scheduled") return AppointmentStatus::Scheduled;
+        if (text == "Completed") return AppointmentStatus::Completed;
+        if (text == "Cancelled") return AppointmentStatus::Cancelled;
+        throw runtime_error("Unknown appointment status: " + string(text));
+    }
+}
+
+namespace Schema {
+    // EntityKey in memory, the ID text in CSV, the raw key in the snapshot
+    struct Key {
+        static void parse(string_view text, uint64_t& key) { key = EntityKey::encode(text); }
+        static void format(uint64_t key, string& out) { out += EntityKey::decode(key); }
+        static void write(uint64_t key, BinaryWriter& out) { out.writeFixed(key); }
+        static void read(BinaryReader& in, uint64_t& key) { key = in.readFixed<uint64_t>(); }
+    };
+    
+    struct Status {
+        static void parse(string_view text, AppointmentStatus& status) { status = AppointmentStatusText::parse(text); }
+        static void format(AppointmentStatus status, string& out) { out += AppointmentStatusText::toString(status); }
+        static void write(AppointmentStatus status, BinaryWriter& out) { out.writeFixed(static_cast<uint8_t>(status)); }
+        static void read(BinaryReader& in, AppointmentStatus& status) {
+            uint8_t code = in.readFixed<uint8_t>();
+            if (code > static_cast<uint8_t>(AppointmentStatus::Cancelled)) {
+                throw runtime_error("Invalid appointment status code");
+            }
+            status = static_cast<AppointmentStatus>(code);
+        }
+    };
+}
+
+// Field values of one appointment, packed as the store keeps them: IDs as
+// EntityKeys and date plus time as minutes since the epoch
+struct AppointmentRecord {
+    static constexpr int32_t minutesPerDay = 24 * 60;
+    
+    static int32_t pack(Date date, TimeOfDay time) {
+        return date.dayNumber() * minutesPerDay + time.minutesSinceMidnight();
+    }
+    static Date dateOf(int32_t when) {
+        int32_t day = when / minutesPerDay;
+        return Date(when % minutesPerDay < 0 ? day - 1 : day);
+    }
+    static TimeOfDay timeOf(int32_t when) {
+        return TimeOfDay((when % minutesPerDay + minutesPerDay) % minutesPerDay);
+    }
+    
+    // The date and time columns each replace their half of `when`
+    struct DateColumn {
+        static void parse(string_view text, int32_t& when) { when = pack(Date::parse(text), timeOf(when)); }
+        static void format(int32_t when, string& out) { out += dateOf(when).toString(); }
+        static void write(int32_t when, BinaryWriter& out) { out.writeFixed(dateOf(when).dayNumber()); }
+        static void read(BinaryReader& in, int32_t& when) { when = pack(Date(in.readFixed<int32_t>()), timeOf(when)); }
+    };
+    
+    struct TimeColumn {
+        static void parse(string_view text, int32_t& when) { when = pack(dateOf(when), TimeOfDay::parse(text)); }
+        static void format(int32_t when, string& out) { out += timeOf(when).toString(); }
+        static void write(int32_t when, BinaryWriter& out) {
+            out.writeFixed(static_cast<uint16_t>(timeOf(when).minutesSinceMidnight()));
+        }
+        static void read(BinaryReader& in, int32_t& when) {
+            uint16_t minutes = in.readFixed<uint16_t>();
+            if (minutes >= minutesPerDay) throw runtime_error("Invalid appointment time");
+            when = pack(dateOf(when), TimeOfDay(minutes));
+        }
+    };
+    
+    uint64_t id = 0;
+    uint64_t patient = 0;
+    uint64_t doctor = 0;
+    int32_t when = 0;
+    AppointmentStatus status = AppointmentStatus::Scheduled;
+    string notes;
+    
+    static constexpr const char* schemaName = "appointment";
+    static constexpr auto schema() {
+        return make_tuple(
+            Schema::field<Schema::Key>("id", [](auto& record) -> auto& { return record.id; }),
+            Schema::field<Schema::Key>("patient", [](auto& record) -> auto& { return record.patient; }),
+            Schema::field<Schema::Key>("doctor", [](auto& record) -> auto& { return record.doctor; }),
+            Schema::field<DateColumn>("date", [](auto& record) -> auto& { return record.when; }),
+            Schema::field<TimeColumn>("time", [](auto& record) -> auto& { return record.when; }),
+            Schema::field<Schema::Status>("status", [](auto& record) -> auto& { return record.status; }),
+            Schema::field<Schema::Text>("notes", [](auto& record) -> auto& { return record.notes; })
+        );
+    }
+};
+
+// Appointments as parallel columns, one row each. Patient and doctor are
+// EntityKey-encoded, date and time are packed into minutes since the epoch,
+// and notes, which scans never read, live in a side table. A row keeps its
+// index until erased; freed rows are reused.
+class AppointmentStore {
+public:
+    // Zero keys match any doctor or patient; `when` is the half-open range [from, to)
+    struct Query {
+        uint64_t doctor = 0;
+        uint64_t patient = 0;
+        int32_t from = numeric_limits<int32_t>::min();
+        int32_t to = numeric_limits<int32_t>::max();
+        uint8_t statuses = 0xFF; // Bit per AppointmentStatus
+        
+        void onlyStatus(AppointmentStatus status) { statuses &= static_cast<uint8_t>(1u << static_cast<unsigned>(status)); }
+    };
+    
+private:
+    vector<uint64_t> ids; // 0 marks a free row
+    vector<uint64_t> patients;
+    vector<uint64_t> doctors;
+    vector<int32_t> times;
+    vector<AppointmentStatus> statuses;
+    unordered_map<uint32_t, string> notes;
+    vector<uint32_t> freeRows;
+    
+    // Branch-free so the compiler can vectorize the scans
+    bool matches(size_t row, const Query& query) const {
+        return (ids[row] != 0) &
+               ((query.doctor == 0) | (doctors[row] == query.doctor)) &
+               ((query.patient == 0) | (patients[row] == query.patient)) &
+               (times[row] >= query.from) & (times[row] < query.to) &
+               (((query.statuses >> static_cast<unsigned>(statuses[row])) & 1u) != 0);
+    }
+    
+public:
+    size_t size() const { return ids.size() - freeRows.size(); }
+    
+    void clear() {
+        ids.clear();
+        patients.clear();
+        doctors.clear();
+        times.clear();
+        statuses.clear();
+        notes.clear();
+        freeRows.clear();
+    }
+    
+    uint32_t insert(AppointmentRecord record) {
+        uint32_t row;
+        if (!freeRows.empty()) {
+            row = freeRows.back();
+            freeRows.pop_back();
+            ids[row] = record.id;
+            patients[row] = record.patient;
+            doctors[row] = record.doctor;
+            times[row] = record.when;
+            statuses[row] = record.status;
+        } else {
+            row = static_cast<uint32_t>(ids.size());
+            ids.push_back(record.id);
+            patients.push_back(record.patient);
+            doctors.push_back(record.doctor);
+            times.push_back(record.when);
+            statuses.push_back(record.status);
+        }
+        setNotes(row, move(record.notes));
+        return row;
+    }
+    
+    AppointmentRecord record(uint32_t row) const {
+        AppointmentRecord record;
+        record.id = ids[row];
+        record.patient = patients[row];
+        record.doctor = doctors[row];
+        record.when = times[row];
+        record.status = statuses[row];
+        record.notes = note(row);
+        return record;
+    }
+    
+    void erase(uint32_t row) {
+        ids[row] = 0;
+        notes.erase(row);
+        freeRows.push_back(row);
+    }
+    
+    uint64_t id(uint32_t row) const { return ids[row]; }
+    uint64_t patient(uint32_t row) const { return patients[row]; }
+    uint64_t doctor(uint32_t row) const { return doctors[row]; }
+    int32_t when(uint32_t row) const { return times[row]; }
+    AppointmentStatus status(uint32_t row) const { return statuses[row]; }
+    
+    string note(uint32_t row) const {
+        auto it = notes.find(row);
+        return it == notes.end() ? string() : it->second;
+    }
+    
+    void setWhen(uint32_t row, int32_t when) { times[row] = when; }
+    void setStatus(uint32_t row, AppointmentStatus status) { statuses[row] = status; }
+    
+    void setNotes(uint32_t row, string note) {
+        if (note.empty()) {
+            notes.erase(row);
+        } else {
+            notes[row] = move(note);
+        }
+    }
+    
+    template <typename Visit>
+    void select(const Query& query, Visit visit) const {
+        for (size_t row = 0; row < ids.size(); row++) {
+            if (matches(row, query)) visit(static_cast<uint32_t>(row));
+        }
+    }
+    
+    size_t count(const Query& query) const {
+        size_t total = 0;
+        for (size_t row = 0; row < ids.size(); row++) {
+            total += matches(row, query);
+        }
+        return total;
+    }
+};
+
+// Accessor view over one AppointmentStore row. Until Hospital attaches it,
+// a new appointment keeps its fields in a record of its own; erasing detaches it
+// again, so handles held elsewhere stay readable.
+class Appointment {
+private:
+    AppointmentStore* store = nullptr;
+    uint32_t row = 0;
+    // Fields while detached; released on attach so a stored view stays small.
+    // Short-lived, so it comes from the general heap rather than a slab pool,
+    // where the freed blocks could only be reused for this one size.
+    unique_ptr<AppointmentRecord> staged = make_unique<AppointmentRecord>();
+    
+    AppointmentRecord current() const { return store ? store->record(row) : *staged; }
+    uint64_t currentId() const { return store ? store->id(row) : staged->id; }
+    uint64_t currentPatient() const { return store ? store->patient(row) : staged->patient; }
+    uint64_t currentDoctor() const { return store ? store->doctor(row) : staged->doctor; }
+    int32_t currentWhen() const { return store ? store->when(row) : staged->when; }
+    
+    void setWhen(int32_t packed) {
+        if (store) {
+            store->setWhen(row, packed);
+        } else {
+            staged->when = packed;
+        }
+    }
+    
+public:
+    explicit Appointment(Schema::Blank) {}
+    
+    Appointment(const string& id, const string& patientId, const string& doctorId,
+                Date date, TimeOfDay time, AppointmentStatus status = AppointmentStatus::Scheduled,
+                string notes = "") {
+        staged->id = EntityKey::encode(id);
+        staged->patient = EntityKey::encode(patientId);
+        staged->doctor = EntityKey::encode(doctorId);
+        staged->when = AppointmentRecord::pack(date, time);
+        staged->status = status;
+        staged->notes = move(notes);
+    }
+    
+    ~Appointment() {
+        if (store) store->erase(row);
+    }
+    Appointment(const Appointment&) = delete;
+    Appointment& operator=(const Appointment&) = delete;
+    
+    // Moves the fields into a new row of `target`
+    void attach(AppointmentStore& target) {
+        if (store) return;
+        row = target.insert(move(*staged));
+        staged.reset();
+        store = &target;
+    }
+    
+    // Copies the row back into the view and frees it
+    void detach() {
+        if (!store) return;
+        staged = make_unique<AppointmentRecord>(store->record(row));
+        store->erase(row);
+        store = nullptr;
+    }
+    
+    uint64_t getKey() const { return currentId(); }
+    uint64_t getPatientKey() const { return currentPatient(); }
+    uint64_t getDoctorKey() const { return currentDoctor(); }
+    int32_t getWhen() const { return currentWhen(); }
+    string getId() const { return EntityKey::decode(currentId()); }
+    string getPatientId() const { return EntityKey::decode(currentPatient()); }
+    string getDoctorId() const { return EntityKey::decode(currentDoctor()); }
+    Date getDate() const { return AppointmentRecord::dateOf(currentWhen()); }
+    TimeOfDay getTime() const { return AppointmentRecord::timeOf(currentWhen()); }
+    AppointmentStatus getStatusCode() const { return store ? store->status(row) : staged->status; }
+    string getStatus() const { return AppointmentStatusText::toString(getStatusCode()); }
+    string getNotes() const { return store ? store->note(row) : staged->notes; }
+    
+    void setDate(Date date) { setWhen(AppointmentRecord::pack(date, getTime())); }
+    void setTime(TimeOfDay time) { setWhen(AppointmentRecord::pack(getDate(), time)); }
+    
+    void setStatus(AppointmentStatus status) {
+        if (store) {
+            store->setStatus(row, status);
+        } else {
+            staged->status = status;
+        }
+    }
+    
+    void setNotes(const string& notes) {
+        if (store) {
+            store->setNotes(row, notes);
+        } else {
+            staged->notes = notes;
+        }
+    }
+    
+    string serialize() const {
+        return Schema::formatCsv(current());
+    }
+    
+    void display() const {
+        cout << "Appointment ID: " << getId() << "\n";
+        cout << "Patient ID: " << getPatientId() << "\n";
+        cout << "Doctor ID: " << getDoctorId() << "\n";
+        cout << "Date: " << getDate() << "\n";
+        cout << "Time: " << getTime() << "\n";
+        cout << "Status: " << getStatus() << "\n";
+        string notes = getNotes();
+        if (!notes.empty()) {
+            cout << "Notes: " << notes << "\n";
+        }
+    }
+    
+    void writeBinary(BinaryWriter& out) const {
+        Schema::writeBinary(current(), out);
+    }
+    
+    static shared_ptr<Appointment> readBinary(BinaryReader& in) {
+        auto appointment = EntityPool::create<Appointment>(Schema::blank);
+        Schema::readBinary(in, *appointment->staged);
+        return appointment;
+    }
+    
+    static shared_ptr<Appointment> deserialize(string_view data) {
+        auto appointment = EntityPool::create<Appointment>(Schema::blank);
+        Schema::parseCsv(data, *appointment->staged);
+        return appointment;
+    }
+};
+
+struct PersistenceMetrics {
+    size_t queueDepth;                // batches waiting or being written
+    uint64_t submitted;               // batches accepted since startup
+    uint64_t writes;                  // write passes after coalescing
+    double lagMilliseconds;           // age of the oldest batch not yet durable
+    double lastLatencyMilliseconds;   // submit-to-durable time of the last pass
+};
+
+// Performs journal appends and base-file rewrites on a background thread so
+// the interactive thread never waits on the disk. Batches are applied in
+// submission order; runs of adjacent journal batches become one write and
+// one fsync, and runs of adjacent file rewrites keep only the newest
+// content per file.
+class PersistenceWorker {
+private:
+    struct Batch {
+        bool journalAppend = false;
+        string records;                          // journal text
+        vector<pair<string, string>> files;      // path -> full new content
+        bool truncateJournal = false;
+        uint64_t ticket = 0;
+        chrono::steady_clock::time_point submitted;
+    };
+    
+    string journalPath;
+    FILE* journalFile = nullptr;                 // touched only by the worker thread
+    function<void()> beforeWrite;
+    
+    mutable mutex lock;
+    condition_variable wake;
+    condition_variable progress;
+    deque<Batch> pending;
+    bool writing = false;
+    chrono::steady_clock::time_point writingSince;
+    bool stopping = false;
+    uint64_t nextTicket = 1;
+    uint64_t writtenTicket = 0;   // handed to the OS
+    uint64_t durableTicket = 0;   // fsynced
+    uint64_t writeCount = 0;
+    double lastLatency = 0.0;
+    exception_ptr failure;
+    thread worker;
+    
+    // Writes beside the target, syncs, and renames over it, so a crash leaves
+    // either the complete old file or the complete new one
+    static void writeFileAtomically(const string& path, const string& content) {
+        string tempFile = path + ".tmp";
+        FILE* file = fopen(tempFile.c_str(), "wb");
+        if (!file) {
+            throw runtime_error("Could not open " + tempFile + " for writing");
+        }
+        bool written = fwrite(content.data(), 1, content.size(), file) == content.size();
+        written = FileUtil::syncToDisk(file) && written;
+        written = fclose(file) == 0 && written;
+        if (!written) {
+            throw runtime_error("Could not write " + tempFile);
+        }
+        filesystem::rename(tempFile, path);
+    }
+    
+    void truncateJournal() {
+        if (journalFile) {
+            fclose(journalFile);
+            journalFile = nullptr;
+        }
+        FILE* f = fopen(journalPath.c_str(), "wb");
+        if (!f) {
+            throw runtime_error("Could not truncate journal file " + journalPath);
+        }
+        bool synced = FileUtil::syncToDisk(f);
+        if (fclose(f) != 0 || !synced) {
+            throw runtime_error("Could not truncate journal file " + journalPath);
+        }
+    }
+    
+    void markDone(uint64_t ticket, bool durable, chrono::steady_clock::time_point submitted) {
+        lock_guard<mutex> guard(lock);
+        writtenTicket = ticket;
+        if (durable) {
+            durableTicket = ticket;
+            writing = false;
+            writeCount++;
+            lastLatency = chrono::duration<double, milli>(chrono::steady_clock::now() - submitted).count();
+        }
+        progress.notify_all();
+    }
+    
+    void write(Batch& batch) {
+        if (beforeWrite) {
+            beforeWrite();
+        }
+        if (batch.journalAppend) {
+            if (!journalFile) {
+                // A failed pass may have left half a record behind
+                FileUtil::trimToLastLine(journalPath);
+                journalFile = fopen(journalPath.c_str(), "ab");
+                if (!journalFile) {
+                    throw runtime_error("Could not open journal file " + journalPath);
+                }
+            }
+            if (fwrite(batch.records.data(), 1, batch.records.size(), journalFile) != batch.records.size() ||
+                fflush(journalFile) != 0) {
+                throw runtime_error("Could not write to journal file " + journalPath);
+            }
+            markDone(batch.ticket, false, batch.submitted);
+            if (!FileUtil::syncToDisk(journalFile)) {
+                throw runtime_error("Could not sync journal file " + journalPath);
+            }
+        } else {
+            for (const auto& file : batch.files) {
+                writeFileAtomically(file.first, file.second);
+            }
+            if (batch.truncateJournal) {
+                truncateJournal();
+            }
+        }
+        markDone(batch.ticket, true, batch.submitted);
+    }
+    
+    void run() {
+        unique_lock<mutex> guard(lock);
+        while (true) {
+            wake.wait(guard, [this]() { return stopping || !pending.empty(); });
+            if (pending.empty()) return;
+            
+            Batch batch = move(pending.front());
+            pending.pop_front();
+            while (!pending.empty() && pending.front().journalAppend == batch.journalAppend) {
+                Batch& next = pending.front();
+                if (batch.journalAppend) {
+                    batch.records += next.records;
+                } else {
+                    for (auto& file : next.files) {
+                        auto same = find_if(batch.files.begin(), batch.files.end(),
+                                            [&](const auto& existing) { return existing.first == file.first; });
+                        if (same != batch.files.end()) {
+                            same->second = move(file.second);
+                        } else {
+                            batch.files.push_back(move(file));
+                        }
+                    }
+                    batch.truncateJournal = batch.truncateJournal || next.truncateJournal;
+                }
+                batch.ticket = next.ticket;
+                pending.pop_front();
+            }
+            writing = true;
+            writingSince = batch.submitted;
+            
+            guard.unlock();
+            try {
+                write(batch);
+            } catch (const exception& e) {
+                cerr << "Error in background persistence: " << e.what() << endl;
+                if (journalFile) {
+                    fclose(journalFile);
+                    journalFile = nullptr;
+                }
+                lock_guard<mutex> failed(lock);
+                if (!failure) failure = current_exception();
+                writtenTicket = durableTicket = batch.ticket;
+                writing = false;
+                progress.notify_all();
+            }
+            guard.lock();
+        }
+    }
+    
+    // A failure is reported to one caller; later batches are attempted again
+    void rethrowFailure() {
+        if (failure) {
+            exception_ptr reported = failure;
+            failure = nullptr;
+            rethrow_exception(reported);
+        }
+    }
+    
+    // Takes the batch only once no failure is waiting to be reported
+    void submit(Batch& batch) {
+        lock_guard<mutex> guard(lock);
+        rethrowFailure();
+        batch.ticket = nextTicket++;
+        batch.submitted = chrono::steady_clock::now();
+        pending.push_back(move(batch));
+        wake.notify_one();
+    }
+    
+    void waitFor(const uint64_t& reached) {
+        unique_lock<mutex> guard(lock);
+        uint64_t target = nextTicket - 1;
+        progress.wait(guard, [&]() { return reached >= target; });
+        rethrowFailure();
+    }
+    
+public:
+    explicit PersistenceWorker(const string& journalPath)
+        : journalPath(journalPath), worker(&PersistenceWorker::run, this) {}
+    
+    PersistenceWorker(const PersistenceWorker&) = delete;
+    PersistenceWorker& operator=(const PersistenceWorker&) = delete;
+    
+    // Drains everything still queued before the thread exits
+    ~PersistenceWorker() {
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_one();
+        worker.join();
+        if (journalFile) {
+            fclose(journalFile);
+        }
+    }
+    
+    // Runs on the worker before each write pass, e.g. to make files the
+    // written records point into durable first
+    void setBeforeWrite(function<void()> hook) {
+        lock_guard<mutex> guard(lock);
+        beforeWrite = move(hook);
+    }
+    
+    // If an earlier failure is reported instead, the records are left in
+    // `records` so the caller can submit them again
+    void appendJournal(string&& records) {
+        Batch batch;
+        batch.journalAppend = true;
+        batch.records = move(records);
+        try {
+            submit(batch);
+        } catch (...) {
+            records = move(batch.records);
+            throw;
+        }
+    }
+    
+    void replaceFiles(vector<pair<string, string>> files, bool truncateJournalAfter) {
+        Batch batch;
+        batch.journalAppend = false;
+        batch.files = move(files);
+        batch.truncateJournal = truncateJournalAfter;
+        submit(batch);
+    }
+    
+    // Barrier: everything submitted so far has been handed to the OS
+    void flush() { waitFor(writtenTicket); }
+    
+    // Barrier: everything submitted so far is on stable storage
+    void waitDurable() { waitFor(durableTicket); }
+    
+    PersistenceMetrics metrics() const {
+        lock_guard<mutex> guard(lock);
+        PersistenceMetrics result{pending.size() + (writing ? 1 : 0), nextTicket - 1, writeCount, 0.0, lastLatency};
+        auto oldest = writing ? writingSince : (pending.empty() ? chrono::steady_clock::now() : pending.front().submitted);
+        result.lagMilliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - oldest).count();
+        return result;
+    }
+};
+
+// Append-only write-ahead log of entity mutations. Each record is one line:
+//   UPSERT,<PATIENT|DOCTOR|DEPARTMENT|APPOINTMENT>,<serialized row>
+//   DELETE,<PATIENT|DOCTOR|DEPARTMENT|APPOINTMENT>,<id>
+// Upserts carry the full row so replaying a record twice is harmless.
+// Records are buffered on the calling thread and handed to the persistence
+// worker at each commit, which writes them with a single fsync (group commit).
+class Journal {
+private:
+    string path;
+    PersistenceWorker& writer;
+    string pending;
+    size_t pendingRecords = 0;
+    size_t committedRecords = 0;
+    bool holding = false;
+    
+    static const size_t groupCommitLimit = 64;
+    
+public:
+    Journal(const string& path, PersistenceWorker& writer) : path(path), writer(writer) {}
+    
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+    
+    // Drops a record left half-written by a crash, before anything is appended
+    void discardTornRecord() {
+        if (uintmax_t dropped = FileUtil::trimToLastLine(path)) {
+            cerr << "Warning: dropped an incomplete record (" << dropped << " bytes) at the end of " << path << endl;
+        }
+    }
+    
+    // Reads every complete record currently in the journal
+    vector<string> readRecords() const {
+        vector<string> records;
+        ifstream in(path);
+        if (!in) return records;
+        
+        // Payloads are CSV rows, so a quoted field may span lines
+        string text((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+        CsvUtil::forEachRecord(text, [&](string_view record) {
+            records.emplace_back(record);
+        });
+        return records;
+    }
+    
+    void append(const string& op, const string& type, const string& payload) {
+        pending += op + "," + type + "," + payload + "\n";
+        pendingRecords++;
+        if (pendingRecords >= groupCommitLimit && !holding) {
+            commit();
+        }
+    }
+    
+    // While held, records collect until an explicit commit() or checkpoint()
+    void holdCommits(bool hold) { holding = hold; }
+    
+    // Queues the buffered records; use the worker's barriers to wait for them.
+    // If the worker reports an earlier failure, the records stay buffered.
+    void commit() {
+        if (pending.empty()) return;
+        writer.appendJournal(move(pending));
+        committedRecords += pendingRecords;
+        pending.clear();
+        pendingRecords = 0;
+    }
+    
+    // Records on disk that have not yet been folded into the base files
+    size_t size() const { return committedRecords + pendingRecords; }
+    
+    // A replay reads the whole journal back, so after it the journal holds
+    // exactly `count` records, however many were counted before
+    void noteReplayed(size_t count) { committedRecords = count; }
+    
+    // Queues the base-file rewrite of a checkpoint followed by the journal
+    // truncation; records committed after this are written after the truncation
+    void checkpoint(vector<pair<string, string>> baseFiles) {
+        commit();
+        writer.replaceFiles(move(baseFiles), true);
+        committedRecords = 0;
+    }
+};
+
+// Mints IDs of the form <prefix><zero-padded number> from an atomic counter.
+// Safe to call from several threads; never retries or consults the tables.
+class IdGenerator {
+private:
+    string prefix;
+    atomic<uint64_t> nextValue{1};
+    
+public:
+    explicit IdGenerator(string prefix) : prefix(move(prefix)) {}
+    
+    const string& getPrefix() const { return prefix; }
+    uint64_t peek() const { return nextValue.load(memory_order_relaxed); }
+    
+    string next() {
+        uint64_t value = nextValue.fetch_add(1, memory_order_relaxed);
+        
+        char digits[20];
+        int length = 0;
+        do {
+            digits[length++] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value > 0);
+        
+        string id = prefix;
+        id.append(length < 6 ? 6 - length : 0, '0');
+        while (length > 0) {
+            id.push_back(digits[--length]);
+        }
+        return id;
+    }
+    
+    // Moves the counter past `value` if it is not already
+    void advancePast(uint64_t value) {
+        uint64_t current = nextValue.load(memory_order_relaxed);
+        while (current <= value &&
+               !nextValue.compare_exchange_weak(current, value + 1, memory_order_relaxed)) {
+        }
+    }
+    
+    // Moves the counter past an existing ID carrying this generator's prefix
+    void observe(const string& id) {
+        if (id.size() <= prefix.size() || id.compare(0, prefix.size(), prefix) != 0) return;
+        
+        uint64_t value = 0;
+        for (size_t i = prefix.size(); i < id.size(); i++) {
+            if (!isdigit(static_cast<unsigned char>(id[i]))) return;
+            value = value * 10 + static_cast<uint64_t>(id[i] - '0');
+        }
+        advancePast(value);
+    }
+};
+
+// Open-addressing table from entity ID to record. Keys and values live in
+// parallel arrays so a probe only touches the packed keys; linear probing
+// with backward-shift deletion keeps clusters short without tombstones.
+// Iteration order is unspecified; ordered() sorts by ID for listings.
+template <typename T>
+class EntityTable {
+private:
+    static constexpr uint64_t emptyKey = 0; // Never produced: the prefix has a letter
+    
+    vector<uint64_t> keys;
+    vector<shared_ptr<T>> values;
+    size_t count = 0;
+    size_t mask = 0;
+    int shift = 64;
+    
+    size_t home(uint64_t key) const {
+        return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> shift);
+    }
+    
+    // Slot holding `key`, or the empty slot where it would go
+    size_t probe(uint64_t key) const {
+        size_t slot = home(key);
+        while (keys[slot] != emptyKey && keys[slot] != key) {
+            slot = (slot + 1) & mask;
+        }
+        return slot;
+    }
+    
+    void rehash(size_t capacity) {
+        vector<uint64_t> oldKeys(capacity, emptyKey);
+        vector<shared_ptr<T>> oldValues(capacity);
+        oldKeys.swap(keys);
+        oldValues.swap(values);
+        mask = capacity - 1;
+        shift = 64 - BitUtil::lowestSetBit(capacity);
+        
+        for (size_t i = 0; i < oldKeys.size(); i++) {
+            if (oldKeys[i] == emptyKey) continue;
+            size_t slot = probe(oldKeys[i]);
+            keys[slot] = oldKeys[i];
+            values[slot] = move(oldValues[i]);
+        }
+    }
+    
+    // Grows at 3/4 load
+    void reserveSlots(size_t records) {
+        size_t capacity = keys.empty() ? 16 : keys.size();
+        while (records * 4 > capacity * 3) {
+            capacity *= 2;
+        }
+        if (capacity != keys.size()) {
+            rehash(capacity);
+        }
+    }
+    
+    void eraseSlot(size_t hole) {
+        size_t next = hole;
+        while (true) {
+            next = (next + 1) & mask;
+            if (keys[next] == emptyKey) break;
+            // Move an entry back into the hole unless that would put it before its home slot
+            size_t wanted = home(keys[next]);
+            if (((next - wanted) & mask) >= ((next - hole) & mask)) {
+                keys[hole] = keys[next];
+                values[hole] = move(values[next]);
+                hole = next;
+            }
+        }
+        keys[hole] = emptyKey;
+        values[hole].reset();
+        count--;
+    }
+    
+public:
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    
+    void clear() {
+        keys.clear();
+        values.clear();
+        count = 0;
+        mask = 0;
+        shift = 64;
+    }
+    
+    void reserve(size_t records) { reserveSlots(records); }
+    
+    // nullptr if the ID is absent or not a well-formed entity ID
+    shared_ptr<T> get(string_view id) const {
+        uint64_t key;
+        if (!EntityKey::tryEncode(id, key)) return nullptr;
+        return getByKey(key);
+    }
+    
+    shared_ptr<T> getByKey(uint64_t key) const {
+        if (count == 0) return nullptr;
+        size_t slot = probe(key);
+        return keys[slot] == key ? values[slot] : nullptr;
+    }
+    
+    bool contains(string_view id) const {
+        uint64_t key;
+        return count > 0 && EntityKey::tryEncode(id, key) && keys[probe(key)] == key;
+    }
+    
+    // Inserts or replaces the record under its own ID; returns the record it replaced
+    shared_ptr<T> put(shared_ptr<T> value) {
+        uint64_t key = EntityKey::encode(value->getId());
+        reserveSlots(count + 1);
+        size_t slot = probe(key);
+        if (keys[slot] == emptyKey) {
+            keys[slot] = key;
+            count++;
+        }
+        swap(values[slot], value);
+        return value;
+    }
+    
+    bool erase(string_view id) {
+        uint64_t key;
+        if (count == 0 || !EntityKey::tryEncode(id, key)) return false;
+        size_t slot = probe(key);
+        if (keys[slot] != key) return false;
+        eraseSlot(slot);
+        return true;
+    }
+    
+    // Visits every record in slot order
+    template <typename Visit>
+    void forEach(Visit visit) const {
+        for (size_t i = 0; i < keys.size(); i++) {
+            if (keys[i] != emptyKey) visit(values[i]);
+        }
+    }
+    
+    // Records sorted by ID
+    vector<shared_ptr<T>> ordered() const {
+        vector<pair<uint64_t, size_t>> order;
+        order.reserve(count);
+        for (size_t i = 0; i < keys.size(); i++) {
+            if (keys[i] != emptyKey) order.emplace_back(keys[i], i);
+        }
+        sort(order.begin(), order.end());
+        
+        vector<shared_ptr<T>> result;
+        result.reserve(order.size());
+        for (const auto& entry : order) {
+            result.push_back(values[entry.second]);
+        }
+        return result;
+    }
+};
+
+// Patient lookup by name and phone. Name words go into an ordered
+// vocabulary with a posting list of patient slots each, so a prefix query
+// walks only the words that start with it. Typos are handled by a trigram
+// index over the vocabulary (not over patients), whose candidates are then
+// confirmed with a bounded edit distance.
+class PatientSearchIndex {
+private:
+    using Vocabulary = map<string, vector<uint32_t>>;   // name word -> ascending slots
+    
+    vector<string> slotIds;                     // slot -> patient ID, empty once removed
+    vector<vector<const string*>> slotWords;    // slot -> its name words (vocabulary keys)
+    vector<uint32_t> freeSlots;                 // removed slots, reused by the next add
+    unordered_map<string, uint32_t> slots;
+    Vocabulary vocabulary;
+    unordered_map<uint32_t, vector<const string*>> trigrams;
+    set<pair<string, uint32_t>> phones;         // digits only
+    
+    // Vocabulary words accepted for one query word, with their edit cost
+    struct TermMatch {
+        vector<pair<int, Vocabulary::const_iterator>> words;   // ascending cost
+        unordered_map<const string*, int> costs;
+        size_t postings = 0;
+    };
+    
+    static vector<string> tokenize(string_view text) {
+        vector<string> tokens;
+        string current;
+        for (char c : text) {
+            if (isalnum(static_cast<unsigned char>(c))) {
+                current += static_cast<char>(tolower(static_cast<unsigned char>(c)));
+            } else if (!current.empty()) {
+                tokens.push_back(move(current));
+                current.clear();
+            }
+        }
+        if (!current.empty()) {
+            tokens.push_back(move(current));
+        }
+        return tokens;
+    }
+    
+    static string phoneDigits(string_view phone) {
+        string digits;
+        for (char c : phone) {
+            if (isdigit(static_cast<unsigned char>(c))) digits += c;
+        }
+        return digits;
+    }
+    
+    // Digits with only the separators people type in phone numbers
+    static bool looksLikePhone(string_view text) {
+        bool anyDigit = false;
+        for (char c : text) {
+            if (isdigit(static_cast<unsigned char>(c))) {
+                anyDigit = true;
+            } else if (!strchr(" -+().", c)) {
+                return false;
+            }
+        }
+        return anyDigit;
+    }
+    
+    static vector<uint32_t> trigramsOf(const string& word) {
+        string padded = " " + word + " ";
+        vector<uint32_t> result;
+        for (size_t i = 0; i + 3 <= padded.size(); i++) {
+            result.push_back((static_cast<uint32_t>(static_cast<unsigned char>(padded[i])) << 16) |
+                             (static_cast<uint32_t>(static_cast<unsigned char>(padded[i + 1])) << 8) |
+                             static_cast<unsigned char>(padded[i + 2]));
+        }
+        sort(result.begin(), result.end());
+        result.erase(unique(result.begin(), result.end()), result.end());
+        return result;
+    }
+    
+    // Typos allowed for a query word; short words are matched by prefix only
+    static int allowedEdits(size_t length) {
+        return (length < 4) ? 0 : (length < 8) ? 1 : 2;
+    }
+    
+    // Levenshtein distance, or limit + 1 as soon as it must exceed limit
+    static int editDistance(const string& a, const string& b, int limit) {
+        if (abs(static_cast<int>(a.size()) - static_cast<int>(b.size())) > limit) return limit + 1;
+        
+        vector<int> row(b.size() + 1);
+        for (size_t j = 0; j <= b.size(); j++) row[j] = static_cast<int>(j);
+        for (size_t i = 1; i <= a.size(); i++) {
+            int diagonal = row[0];
+            row[0] = static_cast<int>(i);
+            int best = row[0];
+            for (size_t j = 1; j <= b.size(); j++) {
+                int above = row[j];
+                row[j] = min({row[j] + 1, row[j - 1] + 1, diagonal + (a[i - 1] != b[j - 1] ? 1 : 0)});
+                diagonal = above;
+                best = min(best, row[j]);
+            }
+            if (best > limit) return limit + 1;
+        }
+        return row[b.size()];
+    }
+    
+    const string* addWord(const string& word, uint32_t slot) {
+        auto inserted = vocabulary.emplace(word, vector<uint32_t>());
+        vector<uint32_t>& postings = inserted.first->second;
+        auto pos = lower_bound(postings.begin(), postings.end(), slot); // the end unless the slot is reused
+        if (pos == postings.end() || *pos != slot) { // a word may repeat within one name
+            postings.insert(pos, slot);
+        }
+        
+        if (inserted.second) {
+            for (uint32_t trigram : trigramsOf(word)) {
+                trigrams[trigram].push_back(&inserted.first->first);
+            }
+        }
+        return &inserted.first->first;
+    }
+    
+    void removeWord(const string& word, uint32_t slot) {
+        auto it = vocabulary.find(word);
+        if (it == vocabulary.end()) return;
+        
+        vector<uint32_t>& postings = it->second;
+        auto pos = lower_bound(postings.begin(), postings.end(), slot);
+        if (pos != postings.end() && *pos == slot) {
+            postings.erase(pos);
+        }
+        if (!postings.empty()) return;
+        
+        for (uint32_t trigram : trigramsOf(word)) {
+            auto& words = trigrams[trigram];
+            words.erase(std::remove(words.begin(), words.end(), &it->first), words.end());
+            if (words.empty()) {
+                trigrams.erase(trigram);
+            }
+        }
+        vocabulary.erase(it);
+    }
+    
+    // Words starting with `term` cost 0; with typos allowed, words within the
+    // edit limit cost their distance. Only the vocabulary is examined.
+    TermMatch matchTerm(const string& term) const {
+        TermMatch match;
+        auto accept = [&](int cost, Vocabulary::const_iterator word) {
+            if (match.costs.emplace(&word->first, cost).second) {
+                match.words.emplace_back(cost, word);
+                match.postings += word->second.size();
+            }
+        };
+        
+        for (auto it = vocabulary.lower_bound(term);
+             it != vocabulary.end() && it->first.compare(0, term.size(), term) == 0; ++it) {
+            accept(0, it);
+        }
+        
+        int limit = allowedEdits(term.size());
+        if (limit == 0) return match;
+        
+        // A word within `limit` edits keeps all but 3 * limit of the query's trigrams
+        vector<uint32_t> termTrigrams = trigramsOf(term);
+        int required = max(1, static_cast<int>(termTrigrams.size()) - 3 * limit);
+        
+        unordered_map<const string*, int> shared;
+        for (uint32_t trigram : termTrigrams) {
+            auto it = trigrams.find(trigram);
+            if (it == trigrams.end()) continue;
+            for (const string* word : it->second) {
+                shared[word]++;
+            }
+        }
+        
+        vector<pair<int, Vocabulary::const_iterator>> typos;
+        for (const auto& candidate : shared) {
+            if (candidate.second < required || match.costs.count(candidate.first)) continue;
+            int distance = editDistance(term, *candidate.first, limit);
+            if (distance <= limit) {
+                typos.emplace_back(distance, vocabulary.find(*candidate.first));
+            }
+        }
+        sort(typos.begin(), typos.end(), [](const auto& a, const auto& b) {
+            return a.first != b.first ? a.first < b.first : a.second->first < b.second->first;
+        });
+        for (const auto& typo : typos) {
+            accept(typo.first, typo.second);
+        }
+        return match;
+    }
+    
+public:
+    void add(const string& patientId, const string& name, const string& phone) {
+        uint32_t slot;
+        if (!freeSlots.empty()) {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+            slotIds[slot] = patientId;
+        } else {
+            slot = static_cast<uint32_t>(slotIds.size());
+            slotIds.push_back(patientId);
+            slotWords.emplace_back();
+        }
+        slots[patientId] = slot;
+        
+        vector<const string*> words;
+        for (const auto& word : tokenize(name)) {
+            words.push_back(addWord(word, slot));
+        }
+        slotWords[slot] = move(words);
+        
+        string digits = phoneDigits(phone);
+        if (!digits.empty()) {
+            phones.emplace(move(digits), slot);
+        }
+    }
+    
+    void remove(const string& patientId, const string& name, const string& phone) {
+        auto it = slots.find(patientId);
+        if (it == slots.end()) return;
+        uint32_t slot = it->second;
+        
+        for (const auto& word : tokenize(name)) {
+            removeWord(word, slot);
+        }
+        phones.erase({phoneDigits(phone), slot});
+        slotIds[slot].clear();
+        slotWords[slot].clear();
+        freeSlots.push_back(slot);
+        slots.erase(it);
+    }
+    
+    void clear() {
+        slotIds.clear();
+        slotWords.clear();
+        freeSlots.clear();
+        slots.clear();
+        vocabulary.clear();
+        trigrams.clear();
+        phones.clear();
+    }
+    
+    // Up to `limit` patient IDs. Phone-prefix hits come first, then names in
+    // order of total typos across query words. Candidates are drawn from the
+    // query word with the shortest posting lists, cheapest words first, so
+    // the walk stops as soon as no later candidate could rank higher.
+    vector<string> search(string_view query, size_t limit) const {
+        vector<string> results;
+        vector<string> terms = tokenize(query);
+        if (terms.empty() || limit == 0) return results;
+        
+        unordered_set<uint32_t> seen;
+        string digits = phoneDigits(query);
+        if (looksLikePhone(query)) {
+            for (auto it = phones.lower_bound({digits, 0});
+                 it != phones.end() && it->first.compare(0, digits.size(), digits) == 0; ++it) {
+                if (seen.insert(it->second).second) {
+                    results.push_back(slotIds[it->second]);
+                    if (results.size() >= limit) return results;
+                }
+            }
+        }
+        
+        vector<TermMatch> matches;
+        for (const auto& term : terms) {
+            matches.push_back(matchTerm(term));
+            if (matches.back().words.empty()) return results;
+        }
+        size_t driver = 0;
+        for (size_t i = 1; i < matches.size(); i++) {
+            if (matches[i].postings < matches[driver].postings) driver = i;
+        }
+        
+        // Cheapest possible contribution of the other query words
+        int othersFloor = 0;
+        for (size_t i = 0; i < matches.size(); i++) {
+            if (i != driver) othersFloor += matches[i].words.front().first;
+        }
+        
+        size_t wanted = limit - results.size();
+        vector<pair<int, uint32_t>> found;   // (total cost, slot)
+        size_t withinFloor = 0;              // entries of `found` no later candidate can beat
+        int floor = -1;
+        for (const auto& word : matches[driver].words) {
+            if (word.first + othersFloor != floor) {
+                floor = word.first + othersFloor;
+                withinFloor = count_if(found.begin(), found.end(),
+                                       [&](const auto& entry) { return entry.first <= floor; });
+                if (withinFloor >= wanted) break;
+            }
+            
+            for (uint32_t slot : word.second->second) {
+                if (seen.count(slot)) continue;
+                
+                int total = word.first;
+                for (size_t i = 0; i < matches.size() && total >= 0; i++) {
+                    if (i == driver) continue;
+                    int best = -1;
+                    for (const string* slotWord : slotWords[slot]) {
+                        auto cost = matches[i].costs.find(slotWord);
+                        if (cost != matches[i].costs.end() && (best < 0 || cost->second < best)) {
+                            best = cost->second;
+                        }
+                    }
+                    total = (best < 0) ? -1 : total + best;
+                }
+                if (total < 0) continue;
+                
+                seen.insert(slot);
+                found.emplace_back(total, slot);
+                if (total == floor && ++withinFloor >= wanted) break;
+            }
+            if (withinFloor >= wanted) break;
+        }
+        
+        stable_sort(found.begin(), found.end(),
+                    [](const auto& a, const auto& b) { return a.first < b.first; });
+        for (size_t i = 0; i < found.size() && results.size() < limit; i++) {
+            results.push_back(slotIds[found[i].second]);
+        }
+        return results;
+    }
+};
+
+struct HistoryMatch {
+    string patientId;
+    size_t entryIndex;
+    Date date;
+};
+
+// Inverted index from medical history words to the entries containing them.
+// Postings stay sorted by insertion order so multi-word queries intersect by
+// binary search, and each entry's date (its leading "YYYY-MM-DD: " stamp)
+// is stored inline so ranking never reads the entry.
+class HistorySearchIndex {
+private:
+    // `sequence` numbers entries in the order they were added, so every
+    // posting list stays sorted by it with plain appends
+    struct Posting {
+        uint32_t sequence;
+        uint32_t slot;
+        uint32_t entry;
+        int32_t day;
+    };
+    
+    static bool before(const Posting& a, const Posting& b) {
+        return a.sequence < b.sequence;
+    }
+    
+    vector<string> slotIds;                     // slot -> patient ID, empty once removed
+    unordered_map<string, uint32_t> slots;
+    unordered_map<string, vector<Posting>> postings;
+    uint32_t nextSequence = 0;
+    
+    // Distinct lowercase words of an entry, skipping its date stamp
+    static vector<string> termsOf(string_view entry, Date& day) {
+        day = Date();
+        if (entry.size() >= 12 && entry.compare(10, 2, ": ") == 0 && Date::tryParse(entry.substr(0, 10), day)) {
+            entry.remove_prefix(12);
+        }
+        
+        vector<string> terms;
+        string current;
+        for (size_t i = 0; i <= entry.size(); i++) {
+            if (i < entry.size() && isalnum(static_cast<unsigned char>(entry[i]))) {
+                current += static_cast<char>(tolower(static_cast<unsigned char>(entry[i])));
+            } else if (!current.empty()) {
+                if (current.size() > 1) terms.push_back(current);
+                current.clear();
+            }
+        }
+        sort(terms.begin(), terms.end());
+        terms.erase(unique(terms.begin(), terms.end()), terms.end());
+        return terms;
+    }
+    
+    static bool contains(const vector<Posting>& list, const Posting& posting) {
+        auto it = lower_bound(list.begin(), list.end(), posting, before);
+        return it != list.end() && it->sequence == posting.sequence;
+    }
+    
+public:
+    void addEntry(const string& patientId, size_t index, string_view entry) {
+        auto inserted = slots.emplace(patientId, static_cast<uint32_t>(slotIds.size()));
+        if (inserted.second) {
+            slotIds.push_back(patientId);
+        }
+        
+        Date day;
+        vector<string> terms = termsOf(entry, day);
+        Posting posting{nextSequence++, inserted.first->second, static_cast<uint32_t>(index), day.dayNumber()};
+        for (const auto& term : terms) {
+            postings[term].push_back(posting);
+        }
+    }
+    
+    // The patient's postings stay in the lists, skipped by search(), until the
+    // index is rebuilt on the next load or snapshot import
+    void removePatient(const string& patientId) {
+        auto it = slots.find(patientId);
+        if (it == slots.end()) return;
+        slotIds[it->second].clear();
+        slots.erase(it);
+    }
+    
+    void clear() {
+        slotIds.clear();
+        slots.clear();
+        postings.clear();
+        nextSequence = 0;
+    }
+    
+    // Entries containing every query word, newest first
+    vector<HistoryMatch> search(string_view query, size_t limit) const {
+        Date ignored;
+        vector<string> terms = termsOf(query, ignored);
+        if (terms.empty() || limit == 0) return {};
+        
+        vector<const vector<Posting>*> lists;
+        for (const auto& term : terms) {
+            auto it = postings.find(term);
+            if (it == postings.end()) return {};
+            lists.push_back(&it->second);
+        }
+        sort(lists.begin(), lists.end(), [](const auto* a, const auto* b) { return a->size() < b->size(); });
+        
+        vector<Posting> hits;
+        for (const Posting& posting : *lists[0]) {
+            bool all = true;
+            for (size_t i = 1; i < lists.size() && all; i++) {
+                all = contains(*lists[i], posting);
+            }
+            if (all && !slotIds[posting.slot].empty()) hits.push_back(posting);
+        }
+        
+        auto newer = [](const Posting& a, const Posting& b) {
+            return (a.day != b.day) ? a.day > b.day : a.sequence > b.sequence;
+        };
+        if (hits.size() > limit) {
+            partial_sort(hits.begin(), hits.begin() + limit, hits.end(), newer);
+            hits.resize(limit);
+        } else {
+            sort(hits.begin(), hits.end(), newer);
+        }
+        
+        vector<HistoryMatch> matches;
+        for (const Posting& hit : hits) {
+            matches.push_back({slotIds[hit.slot], hit.entry, Date(hit.day)});
+        }
+        return matches;
+    }
+};
+
+struct LoadTiming {
+    string source;
+    size_t records;
+    size_t errors;
+    double milliseconds;
+};
+
+struct FreeSlot {
+    string doctorId;
+    Date date;
+    TimeOfDay time;
+};
+
+class Hospital {
+private:
+    string name;
+    string address;
+    
+    EntityTable<Patient> patients;
+    EntityTable<Doctor> doctors;
+    EntityTable<Department> departments;
+    // Column storage behind every Appointment view; declared first so it
+    // outlives the views held by the table and indexes below
+    AppointmentStore appointmentStore;
+    EntityTable<Appointment> appointments;
+    
+    // (packed date and time, appointment key) keeps every index in
+    // chronological order without decoding IDs
+    using AppointmentKey = pair<int32_t, uint64_t>;
+    using AppointmentTimeline = map<AppointmentKey, shared_ptr<Appointment>>;
+    
+    // Secondary indexes: all appointments by date, and per patient/doctor key
+    AppointmentTimeline appointmentsByDate;
+    unordered_map<uint64_t, AppointmentTimeline> appointmentsByPatient;
+    unordered_map<uint64_t, AppointmentTimeline> appointmentsByDoctor;
+    
+    PatientSearchIndex patientSearch;
+    HistorySearchIndex historySearch;
+    
+    // Reverse indexes over doctors; IDs are kept ordered so listings match `doctors`
+    unordered_map<string, set<string>> doctorsByDepartment;
+    unordered_map<string, set<string>> doctorsBySpecialization;
+    
+    // Booked time ranges of non-cancelled appointments, per doctor and day.
+    // Intervals in a day never overlap, so a map keyed by start minute
+    // answers "does [start, end) collide?" with one lower_bound.
+    struct BookedSlot {
+        int endMinute;
+        uint64_t appointment;
+    };
+    using DaySchedule = map<int, BookedSlot>;
+    unordered_map<uint64_t, map<Date, DaySchedule>> bookedSlots;
+    
+    // Length of every appointment. Booked intervals are derived from it rather
+    // than stored, so it is fixed: a different value would misjudge overlaps
+    // between appointments already on file.
+    static constexpr int appointmentDurationMinutes = 30;
+    
+    // Bookable hours; free-slot search offers starts on a grid of one
+    // appointment duration from the opening time
+    int workdayStartMinutes = 9 * 60;
+    int workdayEndMinutes = 17 * 60;
+    static constexpr int freeSlotSearchDays = 366;
+    
+    const string patientsFile = "patients.csv";
+    const string doctorsFile = "doctors.csv";
+    const string departmentsFile = "departments.csv";
+    const string appointmentsFile = "appointments.csv";
+    const string journalFile = "journal.log";
+    const string snapshotFile = "hospital.snap";
+    const string sequencesFile = "sequences.csv";
+    const string historyFile = "medical_history.log";
+    
+    IdGenerator patientIds{"P"};
+    IdGenerator doctorIds{"D"};
+    IdGenerator departmentIds{"DP"};
+    IdGenerator appointmentIds{"A"};
+    
+    // Snapshot layout: magic, version, four uint64 record counts, the records
+    // (patients, doctors, departments, appointments), then an FNV-1a checksum
+    // of everything before it.
+    static constexpr char snapshotMagic[4] = {'H', 'S', 'N', 'P'};
+    static const uint32_t snapshotVersion = 6;
+    
+    vector<LoadTiming> loadTimings;
+    
+    // Journal records accumulated before the base CSV files are rewritten
+    static const size_t checkpointInterval = 1000;
+    // Declared before the worker, which may still sync it while draining
+    MedicalHistoryStore historyStore{historyFile};
+    
+    PersistenceWorker persistence{journalFile};
+    Journal journal{journalFile, persistence};
+    
+    // Collections whose CSV file is behind memory. Each flag is written only
+    // by the thread loading that collection.
+    struct DirtyCollections {
+        bool patients = false;
+        bool doctors = false;
+        bool departments = false;
+        bool appointments = false;
+        
+        bool any() const { return patients || doctors || departments || appointments; }
+    };
+    DirtyCollections dirty;
+    
+    // Set when loading moved inline history into the history store
+    bool historyMigrated = false;
+    
+    void markDirty(const string& type) {
+        if (type == "PATIENT") dirty.patients = true;
+        else if (type == "DOCTOR") dirty.doctors = true;
+        else if (type == "DEPARTMENT") dirty.departments = true;
+        else if (type == "APPOINTMENT") dirty.appointments = true;
+    }
+    
+    void recordChange(const string& op, const string& type, const string& payload) {
+        markDirty(type);
+        journal.append(op, type, payload);
+    }
+    
+    static AppointmentKey keyOf(const Appointment& appointment) {
+        return AppointmentKey(appointment.getWhen(), appointment.getKey());
+    }
+    
+    const DaySchedule* findDaySchedule(uint64_t doctor, Date date) const {
+        auto doctorIt = bookedSlots.find(doctor);
+        if (doctorIt == bookedSlots.end()) return nullptr;
+        auto dayIt = doctorIt->second.find(date);
+        return (dayIt == doctorIt->second.end()) ? nullptr : &dayIt->second;
+    }
+    
+    static bool overlaps(const DaySchedule& schedule, int start, int end) {
+        auto next = schedule.lower_bound(start);
+        if (next != schedule.end() && next->first < end) return true;
+        if (next != schedule.begin() && prev(next)->second.endMinute > start) return true;
+        return false;
+    }
+    
+    bool bookSlot(const Appointment& appointment) {
+        int start = appointment.getTime().minutesSinceMidnight();
+        int end = start + appointmentDurationMinutes;
+        DaySchedule& schedule = bookedSlots[appointment.getDoctorKey()][appointment.getDate()];
+        if (overlaps(schedule, start, end)) {
+            return false;
+        }
+        schedule.emplace(start, BookedSlot{end, appointment.getKey()});
+        return true;
+    }
+    
+    // Legacy data may hold overlapping bookings, of which only the first got a
+    // slot; once a slot is freed, give it to whichever of the others now fit
+    void rebookOverlapped(const Appointment& freed) {
+        auto doctorIt = appointmentsByDoctor.find(freed.getDoctorKey());
+        if (doctorIt == appointmentsByDoctor.end()) return;
+        
+        Date day = freed.getDate();
+        const AppointmentTimeline& timeline = doctorIt->second;
+        auto it = timeline.lower_bound(AppointmentKey(AppointmentRecord::pack(day, TimeOfDay(0)), 0));
+        for (; it != timeline.end() && AppointmentRecord::dateOf(it->first.first) == day; ++it) {
+            const Appointment& other = *it->second;
+            if (it->first.second == freed.getKey() || other.getStatusCode() == AppointmentStatus::Cancelled) continue;
+            bookSlot(other);
+        }
+    }
+    
+    void freeSlot(const Appointment& appointment) {
+        auto doctorIt = bookedSlots.find(appointment.getDoctorKey());
+        if (doctorIt == bookedSlots.end()) return;
+        auto dayIt = doctorIt->second.find(appointment.getDate());
+        if (dayIt == doctorIt->second.end()) return;
+        
+        auto slotIt = dayIt->second.find(appointment.getTime().minutesSinceMidnight());
+        if (slotIt == dayIt->second.end() || slotIt->second.appointment != appointment.getKey()) return;
+        dayIt->second.erase(slotIt);
+        rebookOverlapped(appointment);
+        if (dayIt->second.empty()) {
+            doctorIt->second.erase(dayIt);
+            if (doctorIt->second.empty()) {
+                bookedSlots.erase(doctorIt);
+            }
+        }
+    }
+    
+    // Earliest grid-aligned start >= minute whose slot is free that day, or -1
+    int firstFreeMinute(const DaySchedule* schedule, int minute) const {
+        int step = appointmentDurationMinutes;
+        auto alignUp = [&](int value) {
+            if (value <= workdayStartMinutes) return workdayStartMinutes;
+            int offset = (value - workdayStartMinutes) % step;
+            return offset ? value + step - offset : value;
+        };
+        
+        for (minute = alignUp(minute); minute + step <= workdayEndMinutes; ) {
+            if (!schedule) return minute;
+            
+            // Skip straight past whichever booking blocks this start
+            auto next = schedule->lower_bound(minute);
+            if (next != schedule->begin() && prev(next)->second.endMinute > minute) {
+                minute = alignUp(prev(next)->second.endMinute);
+            } else if (next != schedule->end() && next->first < minute + step) {
+                minute = alignUp(next->second.endMinute);
+            } else {
+                return minute;
+            }
+        }
+        return -1;
+    }
+    
+    // `key` is the doctor's EntityKey
+    bool nextFreeSlot(const Doctor& doctor, uint64_t key, Date day, int minute, Date lastDay,
+                      Date& slotDay, int& slotMinute) const {
+        while (doctor.nextAvailableDay(day, day) && day <= lastDay) {
+            int free = firstFreeMinute(findDaySchedule(key, day), minute);
+            if (free >= 0) {
+                slotDay = day;
+                slotMinute = free;
+                return true;
+            }
+            day = day.addDays(1);
+            minute = 0;
+        }
+        return false;
+    }
+    
+    void indexAppointment(const shared_ptr<Appointment>& appointment) {
+        AppointmentKey key = keyOf(*appointment);
+        appointmentsByDate[key] = appointment;
+        appointmentsByPatient[appointment->getPatientKey()][key] = appointment;
+        appointmentsByDoctor[appointment->getDoctorKey()][key] = appointment;
+        
+        if (appointment->getStatusCode() != AppointmentStatus::Cancelled && !bookSlot(*appointment)) {
+            // Only reachable with data written before overlaps were rejected
+            cerr << "Warning: appointment " << appointment->getId()
+                 << " overlaps another booking for doctor " << appointment->getDoctorId() << endl;
+        }
+    }
+    
+    void unindexAppointment(const shared_ptr<Appointment>& appointment) {
+        AppointmentKey key = keyOf(*appointment);
+        auto eraseFrom = [&](unordered_map<uint64_t, AppointmentTimeline>& index, uint64_t owner) {
+            auto it = index.find(owner);
+            if (it == index.end()) return;
+            it->second.erase(key);
+            if (it->second.empty()) {
+                index.erase(it);
+            }
+        };
+        appointmentsByDate.erase(key);
+        eraseFrom(appointmentsByPatient, appointment->getPatientKey());
+        eraseFrom(appointmentsByDoctor, appointment->getDoctorKey());
+        freeSlot(*appointment);
+    }
+    
+    // Appointments with fromDate <= date <= toDate, in (date, time) order
+    static vector<shared_ptr<Appointment>> collectRange(const AppointmentTimeline& timeline,
+                                                        Date fromDate, Date toDate) {
+        vector<shared_ptr<Appointment>> result;
+        auto it = timeline.lower_bound(AppointmentKey(AppointmentRecord::pack(fromDate, TimeOfDay(0)), 0));
+        auto end = timeline.lower_bound(AppointmentKey(AppointmentRecord::pack(toDate.addDays(1), TimeOfDay(0)), 0));
+        for (; it != end; ++it) {
+            result.push_back(it->second);
+        }
+        return result;
+    }
+    
+    static vector<shared_ptr<Appointment>> collectIndexed(
+            const unordered_map<uint64_t, AppointmentTimeline>& index, const string& ownerId) {
+        vector<shared_ptr<Appointment>> result;
+        uint64_t owner;
+        if (!EntityKey::tryEncode(ownerId, owner)) return result;
+        auto it = index.find(owner);
+        if (it == index.end()) return result;
+        
+        result.reserve(it->second.size());
+        for (const auto& pair : it->second) {
+            result.push_back(pair.second);
+        }
+        return result;
+    }
+    
+    void putPatient(const shared_ptr<Patient>& patient) {
+        if (patient->attachHistoryStore(&historyStore)) {
+            dirty.patients = true;
+            historyMigrated = true;
+        }
+        
+        auto old = patients.put(patient);
+        if (old) {
+            if (old->getName() == patient->getName() && old->getPhoneNumber() == patient->getPhoneNumber()) {
+                return;
+            }
+            patientSearch.remove(old->getId(), old->getName(), old->getPhoneNumber());
+        }
+        patientSearch.add(patient->getId(), patient->getName(), patient->getPhoneNumber());
+    }
+    
+    void erasePatient(const string& id) {
+        auto patient = patients.get(id);
+        if (!patient) return;
+        patientSearch.remove(id, patient->getName(), patient->getPhoneNumber());
+        historySearch.removePatient(id);
+        patients.erase(id);
+    }
+    
+    // Two sequential passes over the history file. The first keeps only each
+    // record's back link, enough to walk every patient's chain and number its
+    // entries; the second streams the referenced entries into the search
+    // index. No entry text is made resident.
+    void rebuildHistoryIndex() {
+        struct Link {
+            int64_t previous;
+            uint64_t patientKey;
+        };
+        unordered_map<int64_t, Link> links;
+        historyStore.scan([&](int64_t offset, int64_t previous, string_view patientId, string_view) {
+            uint64_t key = 0;
+            EntityKey::tryEncode(patientId, key);
+            links.emplace(offset, Link{previous, key});
+        });
+        
+        unordered_map<int64_t, uint32_t> positions; // Offset -> index in its patient's history
+        vector<int64_t> chain;
+        patients.forEach([&](const shared_ptr<Patient>& patient) {
+            const string id = patient->getId();
+            const uint64_t key = EntityKey::encode(id);
+            HistoryRef ref = patient->getHistoryRef();
+            chain.assign(ref.count, 0);
+            
+            int64_t offset = ref.last;
+            for (uint32_t i = ref.count; i-- > 0; ) {
+                auto it = links.find(offset);
+                if (it == links.end() || it->second.patientKey != key) {
+                    cerr << "Warning: medical history of patient " << id << " is incomplete and was not indexed" << endl;
+                    return;
+                }
+                chain[i] = offset;
+                offset = it->second.previous;
+            }
+            for (uint32_t i = 0; i < chain.size(); i++) {
+                positions.emplace(chain[i], i);
+            }
+        });
+        links.clear();
+        
+        historySearch.clear();
+        historyStore.scan([&](int64_t offset, int64_t, string_view patientId, string_view entry) {
+            auto it = positions.find(offset);
+            if (it != positions.end()) {
+                historySearch.addEntry(string(patientId), it->second, entry);
+            }
+        });
+    }
+    
+    static void removeFromIndex(unordered_map<string, set<string>>& index,
+                                const string& key, const string& doctorId) {
+        auto it = index.find(key);
+        if (it == index.end()) return;
+        it->second.erase(doctorId);
+        if (it->second.empty()) {
+            index.erase(it);
+        }
+    }
+    
+    void indexDoctor(const Doctor& doctor) {
+        doctorsByDepartment[doctor.getDepartmentId()].insert(doctor.getId());
+        doctorsBySpecialization[doctor.getSpecialization()].insert(doctor.getId());
+    }
+    
+    void unindexDoctor(const Doctor& doctor) {
+        removeFromIndex(doctorsByDepartment, doctor.getDepartmentId(), doctor.getId());
+        removeFromIndex(doctorsBySpecialization, doctor.getSpecialization(), doctor.getId());
+    }
+    
+    void putDoctor(const shared_ptr<Doctor>& doctor) {
+        auto old = doctors.put(doctor);
+        if (old) {
+            unindexDoctor(*old);
+        }
+        indexDoctor(*doctor);
+    }
+    
+    void eraseDoctor(const string& id) {
+        auto doctor = doctors.get(id);
+        if (!doctor) return;
+        unindexDoctor(*doctor);
+        doctors.erase(id);
+    }
+    
+    vector<shared_ptr<Doctor>> collectDoctors(const unordered_map<string, set<string>>& index,
+                                              const string& key) const {
+        vector<shared_ptr<Doctor>> result;
+        auto it = index.find(key);
+        if (it == index.end()) return result;
+        
+        result.reserve(it->second.size());
+        for (const auto& doctorId : it->second) {
+            result.push_back(doctors.get(doctorId));
+        }
+        return result;
+    }
+    
+    void putAppointment(const shared_ptr<Appointment>& appointment) {
+        auto old = appointments.put(appointment);
+        if (old) {
+            unindexAppointment(old);
+            old->detach();
+        }
+        appointment->attach(appointmentStore);
+        indexAppointment(appointment);
+    }
+    
+    void eraseAppointment(const shared_ptr<Appointment>& appointment) {
+        unindexAppointment(appointment);
+        appointments.erase(appointment->getId());
+        appointment->detach();
+    }
+    
+    void loadData() {
+        loadTimings.clear();
+        if (!(snapshotIsCurrent() && loadSnapshot())) {
+            loadCsvFiles();
+        }
+        journal.discardTornRecord();
+        replayJournal();
+        restoreIdCounters();
+        historyStore.sync(); // inline history migrated while loading
+        if (historyMigrated) {
+            // Save the new references right away, or every restart would append the entries again
+            checkpoint();
+            persistence.waitDurable();
+            historyMigrated = false;
+        }
+        rebuildHistoryIndex();
+    }
+    
+    // Counters resume from the persisted values, or past the highest ID on file
+    // if that is larger (e.g. records added after the last checkpoint)
+    void restoreIdCounters() {
+        ifstream file(sequencesFile);
         string line;
         while (getline(file, line)) {
-            if (line.empty()) continue;
+            size_t comma = line.find(',');
+            if (comma == string::npos) continue;
             try {
-                auto department = Department::deserialize(line);
-                departments[department->getId()] = department;
+                string prefix = line.substr(0, comma);
+                uint64_t next = stoull(line.substr(comma + 1));
+                for (IdGenerator* generator : {&patientIds, &doctorIds, &departmentIds, &appointmentIds}) {
+                    if (generator->getPrefix() == prefix && next > 0) {
+                        generator->advancePast(next - 1);
+                    }
+                }
             } catch (const exception& e) {
-                cerr << "Error loading department: " << e.what() << endl;
+                cerr << "Error loading ID sequence: " << e.what() << endl;
             }
         }
+        
+        patients.forEach([&](const shared_ptr<Patient>& patient) { patientIds.observe(patient->getId()); });
+        doctors.forEach([&](const shared_ptr<Doctor>& doctor) { doctorIds.observe(doctor->getId()); });
+        departments.forEach([&](const shared_ptr<Department>& department) { departmentIds.observe(department->getId()); });
+        appointments.forEach([&](const shared_ptr<Appointment>& appointment) { appointmentIds.observe(appointment->getId()); });
     }
     
-    void saveDepartments() const {
-        ofstream file(departmentsFile);
-        if (!file) {
-            throw runtime_error("Could not open departments file for writing");
+    string serializeIdCounters() const {
+        string content;
+        for (const IdGenerator* generator : {&patientIds, &doctorIds, &departmentIds, &appointmentIds}) {
+            content += generator->getPrefix() + "," + to_string(generator->peek()) + "\n";
         }
+        return content;
+    }
+    
+    // The snapshot is used only when it is at least as new as every CSV file
+    bool snapshotIsCurrent() const {
+        error_code ec;
+        auto snapshotTime = filesystem::last_write_time(snapshotFile, ec);
+        if (ec) return false;
         
-        for (const auto& pair : departments) {
-            file << pair.second->serialize() << endl;
+        for (const string* csv : {&patientsFile, &doctorsFile, &departmentsFile, &appointmentsFile}) {
+            auto csvTime = filesystem::last_write_time(*csv, ec);
+            if (!ec && csvTime > snapshotTime) {
+                return false;
+            }
         }
+        return true;
     }
     
-    void loadAppointments() {
-        ifstream file(appointmentsFile);
-        if (!file) return;
+    void clearData() {
+        patients.clear();
+        patientSearch.clear();
+        historySearch.clear();
+        doctors.clear();
+        doctorsByDepartment.clear();
+        doctorsBySpecialization.clear();
+        departments.clear();
+        appointments.forEach([](const shared_ptr<Appointment>& appointment) { appointment->detach(); });
+        appointments.clear();
+        appointmentStore.clear();
+        appointmentsByDate.clear();
+        appointmentsByPatient.clear();
+        appointmentsByDoctor.clear();
+        bookedSlots.clear();
+    }
+    
+    bool loadSnapshot() {
+        try {
+            auto started = chrono::steady_clock::now();
+            MappedFile file(snapshotFile);
+            if (!file.isOpen()) return false;
+            
+            string_view image = file.view();
+            const size_t headerSize = sizeof(snapshotMagic) + sizeof(uint32_t) + 4 * sizeof(uint64_t);
+            if (image.size() < headerSize + sizeof(uint64_t) ||
+                memcmp(image.data(), snapshotMagic, sizeof(snapshotMagic)) != 0) {
+                throw runtime_error("Not a hospital snapshot file");
+            }
+            
+            string_view body = image.substr(0, image.size() - sizeof(uint64_t));
+            BinaryReader trailer(image.substr(body.size()));
+            if (trailer.readFixed<uint64_t>() != Checksum::fnv1a(body)) {
+                throw runtime_error("Snapshot checksum mismatch");
+            }
+            
+            BinaryReader in(body.substr(sizeof(snapshotMagic)));
+            uint32_t version = in.readFixed<uint32_t>();
+            if (version != snapshotVersion) {
+                throw runtime_error("Unsupported snapshot version " + to_string(version));
+            }
+            
+            uint64_t patientCount = in.readFixed<uint64_t>();
+            uint64_t doctorCount = in.readFixed<uint64_t>();
+            uint64_t departmentCount = in.readFixed<uint64_t>();
+            uint64_t appointmentCount = in.readFixed<uint64_t>();
+            
+            clearData();
+            patients.reserve(patientCount);
+            doctors.reserve(doctorCount);
+            departments.reserve(departmentCount);
+            appointments.reserve(appointmentCount);
+            for (uint64_t i = 0; i < patientCount; i++) {
+                auto patient = Patient::readBinary(in);
+                patients.put(patient);
+                if (patient->attachHistoryStore(&historyStore)) {
+                    dirty.patients = true;
+                    historyMigrated = true;
+                }
+                patientSearch.add(patient->getId(), patient->getName(), patient->getPhoneNumber());
+            }
+            for (uint64_t i = 0; i < doctorCount; i++) {
+                auto doctor = Doctor::readBinary(in);
+                doctors.put(doctor);
+                indexDoctor(*doctor);
+            }
+            for (uint64_t i = 0; i < departmentCount; i++) {
+                auto department = Department::readBinary(in);
+                departments.put(department);
+            }
+            for (uint64_t i = 0; i < appointmentCount; i++) {
+                putAppointment(Appointment::readBinary(in));
+            }
+            if (in.remaining() != 0) {
+                throw runtime_error("Trailing data in snapshot");
+            }
+            
+            double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - started).count();
+            loadTimings.push_back({snapshotFile,
+                                   static_cast<size_t>(patientCount + doctorCount + departmentCount + appointmentCount),
+                                   0, elapsed});
+            return true;
+        } catch (const exception& e) {
+            cerr << "Error loading snapshot, falling back to CSV files: " << e.what() << endl;
+            clearData();
+            return false;
+        }
+    }
+    
+    string snapshotImage() const {
+        BinaryWriter out;
+        out.writeFixed(static_cast<uint32_t>(snapshotVersion));
+        out.writeFixed(static_cast<uint64_t>(patients.size()));
+        out.writeFixed(static_cast<uint64_t>(doctors.size()));
+        out.writeFixed(static_cast<uint64_t>(departments.size()));
+        out.writeFixed(static_cast<uint64_t>(appointments.size()));
+        for (const auto& patient : patients.ordered()) patient->writeBinary(out);
+        for (const auto& doctor : doctors.ordered()) doctor->writeBinary(out);
+        for (const auto& department : departments.ordered()) department->writeBinary(out);
+        for (const auto& appointment : appointments.ordered()) appointment->writeBinary(out);
         
-        string line;
-        while (getline(file, line)) {
-            if (line.empty()) continue;
-            try {
-                auto appointment = Appointment::deserialize(line);
-                appointments[appointment->getId()] = appointment;
-            } catch (const exception& e) {
-                cerr << "Error loading appointment: " << e.what() << endl;
+        string image(snapshotMagic, sizeof(snapshotMagic));
+        image += out.data();
+        uint64_t checksum = Checksum::fnv1a(image);
+        image.append(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+        return image;
+    }
+    
+    void replayJournal() {
+        size_t replayed = 0;
+        for (const auto& record : journal.readRecords()) {
+            CsvUtil::parseRecovering(record, [&](string_view row) {
+                applyJournalRecord(string(row));
+                replayed++;
+            }, [](const string& message) {
+                // A torn final record from a crash mid-append lands here
+                cerr << "Error replaying journal record: " << message << endl;
+            });
+        }
+        journal.noteReplayed(replayed);
+    }
+    
+    void applyJournalRecord(const string& record) {
+        size_t opEnd = record.find(',');
+        size_t typeEnd = (opEnd == string::npos) ? string::npos : record.find(',', opEnd + 1);
+        if (typeEnd == string::npos) {
+            throw runtime_error("Invalid journal record format");
+        }
+        
+        string op = record.substr(0, opEnd);
+        string type = record.substr(opEnd + 1, typeEnd - opEnd - 1);
+        string payload = record.substr(typeEnd + 1);
+        markDirty(type);
+        
+        if (op == "UPSERT") {
+            if (type == "PATIENT") {
+                putPatient(Patient::deserialize(payload));
+            } else if (type == "DOCTOR") {
+                putDoctor(Doctor::deserialize(payload));
+            } else if (type == "DEPARTMENT") {
+                departments.put(Department::deserialize(payload));
+            } else if (type == "APPOINTMENT") {
+                putAppointment(Appointment::deserialize(payload));
+            } else {
+                throw runtime_error("Unknown journal entity type: " + type);
+            }
+        } else if (op == "DELETE") {
+            // Deleted IDs must not be handed out again
+            if (type == "PATIENT") {
+                patientIds.observe(payload);
+                erasePatient(payload);
+            } else if (type == "DOCTOR") {
+                doctorIds.observe(payload);
+                eraseDoctor(payload);
+            } else if (type == "DEPARTMENT") {
+                departmentIds.observe(payload);
+                departments.erase(payload);
+            } else if (type == "APPOINTMENT") {
+                appointmentIds.observe(payload);
+                auto appointment = appointments.get(payload);
+                if (appointment) {
+                    eraseAppointment(appointment);
+                }
+            } else {
+                throw runtime_error("Unknown journal entity type: " + type);
             }
+        } else {
+            throw runtime_error("Unknown journal operation: " + op);
         }
     }
     
-    void saveAppointments() const {
-        ofstream file(appointmentsFile);
-        if (!file) {
-            throw runtime_error("Could not open appointments file for writing");
+    // Folds the journal into the base files. The files are serialized here and
+    // written by the persistence worker.
+    void checkpoint() {
+        bool changed = dirty.any();
+        auto files = dirtyFiles();
+        if (changed && filesystem::exists(snapshotFile)) {
+            files.emplace_back(snapshotFile, snapshotImage()); // Keep an existing snapshot newer than the CSVs
+        }
+        journal.checkpoint(move(files));
+    }
+    
+    // Current content of the collections changed since they were last saved
+    vector<pair<string, string>> dirtyFiles() {
+        vector<pair<string, string>> files;
+        if (!dirty.any()) return files;
+        if (dirty.patients) files.emplace_back(patientsFile, serializeCsv(patients));
+        if (dirty.doctors) files.emplace_back(doctorsFile, serializeCsv(doctors));
+        if (dirty.departments) files.emplace_back(departmentsFile, serializeCsv(departments));
+        if (dirty.appointments) files.emplace_back(appointmentsFile, serializeCsv(appointments));
+        files.emplace_back(sequencesFile, serializeIdCounters());
+        dirty = DirtyCollections();
+        return files;
+    }
+    
+    // Maps one CSV file, parses it in parallel chunks and hands each record to
+    // `store`. Errors are reported after the workers finish so output stays readable.
+    template <typename T, typename Store>
+    LoadTiming loadCsvFile(const string& file, const string& label, Store store) {
+        auto started = chrono::steady_clock::now();
+        LoadTiming timing{file, 0, 0, 0.0};
+        
+        MappedFile mapped(file);
+        if (mapped.isOpen()) {
+            size_t workers = max(1u, thread::hardware_concurrency());
+            for (auto& chunk : ParallelLoad::parseLines<T>(mapped.view(), workers)) {
+                for (auto& record : chunk.records) {
+                    try {
+                        store(record);
+                        timing.records++;
+                    } catch (const exception& e) {
+                        chunk.errors.push_back(e.what());
+                    }
+                }
+                for (const auto& error : chunk.errors) {
+                    cerr << "Error loading " << label << ": " << error << endl;
+                }
+                timing.errors += chunk.errors.size();
+            }
         }
         
-        for (const auto& pair : appointments) {
-            file << pair.second->serialize() << endl;
+        timing.milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - started).count();
+        return timing;
+    }
+    
+    // The four files fill disjoint members, so each gets its own loader thread
+    void loadCsvFiles() {
+        auto patientsTask = async(launch::async, [this]() {
+            return loadCsvFile<Patient>(patientsFile, "patient", [this](const shared_ptr<Patient>& patient) {
+                putPatient(patient);
+            });
+        });
+        auto doctorsTask = async(launch::async, [this]() {
+            return loadCsvFile<Doctor>(doctorsFile, "doctor", [this](const shared_ptr<Doctor>& doctor) {
+                putDoctor(doctor);
+            });
+        });
+        auto departmentsTask = async(launch::async, [this]() {
+            return loadCsvFile<Department>(departmentsFile, "department", [this](const shared_ptr<Department>& department) {
+                departments.put(department);
+            });
+        });
+        auto appointmentsTask = async(launch::async, [this]() {
+            return loadCsvFile<Appointment>(appointmentsFile, "appointment", [this](const shared_ptr<Appointment>& appointment) {
+                putAppointment(appointment);
+            });
+        });
+        
+        loadTimings.push_back(patientsTask.get());
+        loadTimings.push_back(doctorsTask.get());
+        loadTimings.push_back(departmentsTask.get());
+        loadTimings.push_back(appointmentsTask.get());
+    }
+    
+    template <typename T>
+    static string serializeCsv(const EntityTable<T>& records) {
+        string content;
+        for (const auto& record : records.ordered()) {
+            content += record->serialize();
+            content += '\n';
         }
+        return content;
     }
     
 public:
     Hospital(const string& name, const string& address)
         : name(name), address(address) {
         loadData();
+        // History lines must be durable before any journal record or CSV row refers to them
+        persistence.setBeforeWrite([this]() { historyStore.sync(); });
     }
     
     ~Hospital() {
         try { // Ensure destructor doesn't throw
-            saveData();
+            checkpoint();
+            persistence.waitDurable();
         } catch (const exception& e) {
             cerr << "Error saving data in Hospital destructor: " << e.what() << endl;
         }
@@ -572,224 +4351,1168 @@ public:
     string getName() const { return name; }
     string getAddress() const { return address; }
     
+    // How long each data file took to load at startup
+    const vector<LoadTiming>& getLoadTimings() const { return loadTimings; }
+    
     shared_ptr<Patient> addPatient(const string& name, const string& gender, 
-                                       const string& phoneNumber, const string& dateOfBirth,
+                                       const string& phoneNumber, Date dateOfBirth,
                                        const string& bloodType, const string& insuranceInfo) {
-        string id = generateId("P");
-        auto patient = make_shared<Patient>(id, name, gender, phoneNumber, dateOfBirth, bloodType, insuranceInfo);
-        patients[id] = patient;
-        //savePatients(); // Removed for test harness, kept for interactive menu
+        string id = patientIds.next();
+        auto patient = EntityPool::create<Patient>(id, name, gender, phoneNumber, dateOfBirth, bloodType, insuranceInfo);
+        putPatient(patient);
+        recordChange("UPSERT", "PATIENT", patient->serialize());
         return patient;
     }
     
     bool removePatient(const string& id) {
-        if (patients.find(id) == patients.end()) {
+        if (!patients.contains(id)) {
             return false;
         }
-        patients.erase(id);
-        //savePatients();
+        erasePatient(id);
+        recordChange("DELETE", "PATIENT", id);
         return true;
     }
     
-    shared_ptr<Patient> getPatient(const string& id) const {
-        auto it = patients.find(id);
-        if (it == patients.end()) {
-            return nullptr;
+    bool addMedicalHistoryEntry(const string& patientId, const string& entry) {
+        auto patient = getPatient(patientId);
+        if (!patient) {
+            return false;
         }
-        return it->second;
+        string stored = patient->addMedicalHistoryEntry(entry);
+        historySearch.addEntry(patientId, patient->getHistoryCount() - 1, stored);
+        recordChange("UPSERT", "PATIENT", patient->serialize());
+        return true;
+    }
+    
+    shared_ptr<Patient> getPatient(const string& id) const {
+        return patients.get(id);
+    }
+    
+    // Sorted by ID
+    vector<shared_ptr<Patient>> getAllPatients() const {
+        return patients.ordered();
     }
     
-    const map<string, shared_ptr<Patient>>& getAllPatients() const {
-        return patients;
+    // Medical history entries containing every word of the query, newest first
+    vector<HistoryMatch> searchMedicalHistory(const string& query, size_t limit) const {
+        return historySearch.search(query, limit);
+    }
+    
+    // Name or phone lookup; tolerates prefixes and small typos in names
+    vector<shared_ptr<Patient>> searchPatients(const string& query, size_t limit) const {
+        vector<shared_ptr<Patient>> result;
+        for (const auto& id : patientSearch.search(query, limit)) {
+            result.push_back(patients.get(id));
+        }
+        return result;
     }
     
     shared_ptr<Doctor> addDoctor(const string& name, const string& gender, 
                                      const string& phoneNumber, const string& specialization,
                                      const string& licenseNumber, const string& departmentId) {
-        if (departments.find(departmentId) == departments.end()) {
+        if (!departments.contains(departmentId)) {
             throw runtime_error("Department does not exist");
         }
         
-        string id = generateId("D");
-        auto doctor = make_shared<Doctor>(id, name, gender, phoneNumber, specialization, licenseNumber, departmentId);
-        doctors[id] = doctor;
-        //saveDoctors();
+        string id = doctorIds.next();
+        auto doctor = EntityPool::create<Doctor>(id, name, gender, phoneNumber, specialization, licenseNumber, departmentId);
+        putDoctor(doctor);
+        recordChange("UPSERT", "DOCTOR", doctor->serialize());
         return doctor;
     }
     
     bool removeDoctor(const string& id) {
-        if (doctors.find(id) == doctors.end()) {
+        if (!doctors.contains(id)) {
             return false;
         }
-        doctors.erase(id);
-        //saveDoctors();
+        eraseDoctor(id);
+        recordChange("DELETE", "DOCTOR", id);
+        return true;
+    }
+    
+    bool setDoctorDepartment(const string& doctorId, const string& departmentId) {
+        auto doctor = getDoctor(doctorId);
+        if (!doctor) {
+            return false;
+        }
+        if (!departments.contains(departmentId)) {
+            throw runtime_error("Department does not exist");
+        }
+        removeFromIndex(doctorsByDepartment, doctor->getDepartmentId(), doctorId);
+        doctor->setDepartmentId(departmentId);
+        doctorsByDepartment[departmentId].insert(doctorId);
+        recordChange("UPSERT", "DOCTOR", doctor->serialize());
+        return true;
+    }
+    
+    bool setDoctorSpecialization(const string& doctorId, const string& specialization) {
+        auto doctor = getDoctor(doctorId);
+        if (!doctor) {
+            return false;
+        }
+        removeFromIndex(doctorsBySpecialization, doctor->getSpecialization(), doctorId);
+        doctor->setSpecialization(specialization);
+        doctorsBySpecialization[specialization].insert(doctorId);
+        recordChange("UPSERT", "DOCTOR", doctor->serialize());
+        return true;
+    }
+    
+    vector<shared_ptr<Doctor>> getDoctorsInDepartment(const string& departmentId) const {
+        return collectDoctors(doctorsByDepartment, departmentId);
+    }
+    
+    vector<shared_ptr<Doctor>> getDoctorsBySpecialization(const string& specialization) const {
+        return collectDoctors(doctorsBySpecialization, specialization);
+    }
+    
+    bool addDoctorAvailability(const string& doctorId, Date day) {
+        auto doctor = getDoctor(doctorId);
+        if (!doctor) {
+            return false;
+        }
+        doctor->addAvailableDay(day);
+        recordChange("UPSERT", "DOCTOR", doctor->serialize());
+        return true;
+    }
+    
+    bool removeDoctorAvailability(const string& doctorId, Date day) {
+        auto doctor = getDoctor(doctorId);
+        if (!doctor) {
+            return false;
+        }
+        doctor->removeAvailableDay(day);
+        recordChange("UPSERT", "DOCTOR", doctor->serialize());
+        return true;
+    }
+    
+    bool addDoctorAvailabilityRule(const string& doctorId, const AvailabilityRule& rule) {
+        auto doctor = getDoctor(doctorId);
+        if (!doctor) {
+            return false;
+        }
+        doctor->addAvailabilityRule(rule);
+        recordChange("UPSERT", "DOCTOR", doctor->serialize());
+        return true;
+    }
+    
+    bool removeDoctorAvailabilityRule(const string& doctorId, size_t index) {
+        auto doctor = getDoctor(doctorId);
+        if (!doctor || !doctor->removeAvailabilityRule(index)) {
+            return false;
+        }
+        recordChange("UPSERT", "DOCTOR", doctor->serialize());
+        return true;
+    }
+    
+    bool addDoctorAvailabilityRange(const string& doctorId, Date from, Date to) {
+        auto doctor = getDoctor(doctorId);
+        if (!doctor) {
+            return false;
+        }
+        doctor->addAvailableRange(from, to);
+        recordChange("UPSERT", "DOCTOR", doctor->serialize());
+        return true;
+    }
+    
+    bool removeDoctorAvailabilityRange(const string& doctorId, Date from, Date to) {
+        auto doctor = getDoctor(doctorId);
+        if (!doctor) {
+            return false;
+        }
+        doctor->removeAvailableRange(from, to);
+        recordChange("UPSERT", "DOCTOR", doctor->serialize());
         return true;
     }
     
     shared_ptr<Doctor> getDoctor(const string& id) const {
-        auto it = doctors.find(id);
-        if (it == doctors.end()) {
-            return nullptr;
+        return doctors.get(id);
+    }
+    
+    // Sorted by ID
+    vector<shared_ptr<Doctor>> getAllDoctors() const {
+        return doctors.ordered();
+    }
+    
+    shared_ptr<Department> addDepartment(const string& name, const string& location) {
+        string id = departmentIds.next();
+        auto department = EntityPool::create<Department>(id, name, location);
+        departments.put(department);
+        recordChange("UPSERT", "DEPARTMENT", department->serialize());
+        return department;
+    }
+    
+    bool removeDepartment(const string& id) {
+        if (!departments.contains(id)) {
+            return false;
+        }
+        
+        if (doctorsByDepartment.count(id)) {
+            throw runtime_error("Cannot remove department that has doctors assigned to it");
+        }
+        
+        departments.erase(id);
+        recordChange("DELETE", "DEPARTMENT", id);
+        return true;
+    }
+    
+    shared_ptr<Department> getDepartment(const string& id) const {
+        return departments.get(id);
+    }
+    
+    // Sorted by ID
+    vector<shared_ptr<Department>> getAllDepartments() const {
+        return departments.ordered();
+    }
+    
+    int getAppointmentDuration() const { return appointmentDurationMinutes; }
+    
+    // True if [time, time + duration) does not overlap a non-cancelled booking
+    bool isSlotFree(const string& doctorId, Date date, TimeOfDay time) const {
+        uint64_t doctor;
+        if (!EntityKey::tryEncode(doctorId, doctor)) return true;
+        const DaySchedule* schedule = findDaySchedule(doctor, date);
+        int start = time.minutesSinceMidnight();
+        return !schedule || !overlaps(*schedule, start, start + appointmentDurationMinutes);
+    }
+    
+    shared_ptr<Appointment> scheduleAppointment(const string& patientId, const string& doctorId,
+                                                    Date date, TimeOfDay time) {
+        if (!patients.contains(patientId)) {
+            throw runtime_error("Patient does not exist");
+        }
+        
+        auto doctor = doctors.get(doctorId);
+        if (!doctor) {
+            throw runtime_error("Doctor does not exist");
+        }
+        
+        if (!doctor->isAvailableOn(date)) {
+            throw runtime_error("Doctor is not available on the specified date");
+        }
+        
+        int start = time.minutesSinceMidnight();
+        if (start + appointmentDurationMinutes > 24 * 60) {
+            throw runtime_error("Appointment would run past midnight");
+        }
+        if (!isSlotFree(doctorId, date, time)) {
+            throw runtime_error("Doctor already has an appointment at that time");
+        }
+        
+        string id = appointmentIds.next();
+        auto appointment = EntityPool::create<Appointment>(id, patientId, doctorId, date, time);
+        appointments.put(appointment);
+        appointment->attach(appointmentStore);
+        indexAppointment(appointment);
+        recordChange("UPSERT", "APPOINTMENT", appointment->serialize());
+        return appointment;
+    }
+    
+    bool removeAppointment(const string& id) {
+        auto appointment = appointments.get(id);
+        if (!appointment) {
+            return false;
+        }
+        eraseAppointment(appointment);
+        recordChange("DELETE", "APPOINTMENT", id);
+        return true;
+    }
+    
+    bool cancelAppointment(const string& id) {
+        auto appointment = appointments.get(id);
+        if (!appointment) {
+            return false;
+        }
+        
+        freeSlot(*appointment);
+        appointment->setStatus(AppointmentStatus::Cancelled);
+        recordChange("UPSERT", "APPOINTMENT", appointment->serialize());
+        return true;
+    }
+    
+    bool completeAppointment(const string& id, const string& notes) {
+        auto appointment = appointments.get(id);
+        if (!appointment) {
+            return false;
+        }
+        // Its slot was released on cancellation and may have been rebooked since
+        if (appointment->getStatusCode() == AppointmentStatus::Cancelled) {
+            throw runtime_error("Cannot complete a cancelled appointment");
+        }
+        
+        appointment->setStatus(AppointmentStatus::Completed);
+        appointment->setNotes(notes);
+        
+        auto patient = getPatient(appointment->getPatientId());
+        auto doctor = getDoctor(appointment->getDoctorId());
+        
+        if (patient && doctor) {
+            string historyEntry = "Appointment with Dr. " + doctor->getName() + 
+                                     " (" + doctor->getSpecialization() + ") on " + appointment->getDate().toString() + " at " + appointment->getTime().toString() + ": " + notes;
+            string stored = patient->addMedicalHistoryEntry(historyEntry);
+            historySearch.addEntry(patient->getId(), patient->getHistoryCount() - 1, stored);
+            recordChange("UPSERT", "PATIENT", patient->serialize());
+        }
+        recordChange("UPSERT", "APPOINTMENT", appointment->serialize());
+        return true;
+    }
+    
+    shared_ptr<Appointment> getAppointment(const string& id) const {
+        return appointments.get(id);
+    }
+    
+    // Sorted by ID
+    vector<shared_ptr<Appointment>> getAllAppointments() const {
+        return appointments.ordered();
+    }
+    
+    vector<shared_ptr<Appointment>> getPatientAppointments(const string& patientId) const {
+        return collectIndexed(appointmentsByPatient, patientId);
+    }
+    
+    vector<shared_ptr<Appointment>> getDoctorAppointments(const string& doctorId) const {
+        return collectIndexed(appointmentsByDoctor, doctorId);
+    }
+    
+    vector<shared_ptr<Appointment>> getAppointmentsByDate(Date date) const {
+        return collectRange(appointmentsByDate, date, date);
+    }
+    
+    vector<shared_ptr<Appointment>> getAppointmentsBetween(Date fromDate, Date toDate) const {
+        return collectRange(appointmentsByDate, fromDate, toDate);
+    }
+    
+    vector<shared_ptr<Appointment>> getDoctorCalendar(const string& doctorId,
+                                                      Date fromDate, Date toDate) const {
+        uint64_t doctor;
+        if (!EntityKey::tryEncode(doctorId, doctor)) return {};
+        auto it = appointmentsByDoctor.find(doctor);
+        if (it == appointmentsByDoctor.end()) return {};
+        return collectRange(it->second, fromDate, toDate);
+    }
+    
+    // Query over the appointment columns; empty IDs match any doctor or patient
+    AppointmentStore::Query appointmentQuery(const string& doctorId, const string& patientId,
+                                             Date fromDate, Date toDate) const {
+        AppointmentStore::Query query;
+        query.from = AppointmentRecord::pack(fromDate, TimeOfDay(0));
+        query.to = AppointmentRecord::pack(toDate.addDays(1), TimeOfDay(0));
+        if ((!doctorId.empty() && !EntityKey::tryEncode(doctorId, query.doctor)) ||
+            (!patientId.empty() && !EntityKey::tryEncode(patientId, query.patient))) {
+            query.statuses = 0; // Malformed ID: nothing can match
+        }
+        return query;
+    }
+    
+    vector<shared_ptr<Appointment>> selectAppointments(const AppointmentStore::Query& query) const {
+        vector<AppointmentKey> rows;
+        appointmentStore.select(query, [&](uint32_t row) {
+            rows.emplace_back(appointmentStore.when(row), appointmentStore.id(row));
+        });
+        sort(rows.begin(), rows.end());
+        
+        vector<shared_ptr<Appointment>> result;
+        result.reserve(rows.size());
+        for (const auto& row : rows) {
+            result.push_back(appointments.getByKey(row.second));
+        }
+        return result;
+    }
+    
+    // Appointments with `status` between the two dates (inclusive), in
+    // chronological order, found by a sequential scan of the columns
+    vector<shared_ptr<Appointment>> findAppointments(const string& doctorId, const string& patientId,
+                                                     Date fromDate, Date toDate, AppointmentStatus status) const {
+        AppointmentStore::Query query = appointmentQuery(doctorId, patientId, fromDate, toDate);
+        query.onlyStatus(status);
+        return selectAppointments(query);
+    }
+    
+    size_t countAppointments(const string& doctorId, const string& patientId,
+                             Date fromDate, Date toDate, AppointmentStatus status) const {
+        AppointmentStore::Query query = appointmentQuery(doctorId, patientId, fromDate, toDate);
+        query.onlyStatus(status);
+        return appointmentStore.count(query);
+    }
+    
+    // Earliest `count` open slots on or after `fromDate` among doctors whose
+    // specialization or department ID equals `criterion`; a search from a past
+    // day starts at the current time today. Each doctor contributes a cursor at its next free
+    // slot; a min-heap hands out the globally earliest one and only that
+    // doctor's cursor is advanced.
+    vector<FreeSlot> findFreeSlots(const string& criterion, Date fromDate, size_t count) const {
+        struct Cursor {
+            Date day;
+            int minute;
+            uint64_t key;
+            const Doctor* doctor;
+        };
+        auto later = [](const Cursor& a, const Cursor& b) {
+            if (a.day != b.day) return b.day < a.day;
+            if (a.minute != b.minute) return a.minute > b.minute;
+            return a.key > b.key;
+        };
+        priority_queue<Cursor, vector<Cursor>, decltype(later)> queue(later);
+        
+        Date today = Date::today();
+        if (fromDate < today) {
+            fromDate = today;
+        }
+        Date lastDay = fromDate.addDays(freeSlotSearchDays - 1);
+        auto candidates = getDoctorsBySpecialization(criterion);
+        for (const auto& doctor : getDoctorsInDepartment(criterion)) {
+            if (doctor->getSpecialization() != criterion) {
+                candidates.push_back(doctor);
+            }
+        }
+        
+        int fromMinute = (fromDate == today) ? TimeOfDay::now().minutesSinceMidnight() : 0;
+        for (const auto& candidate : candidates) {
+            const Doctor& doctor = *candidate;
+            Cursor cursor{fromDate, 0, 0, &doctor};
+            EntityKey::tryEncode(doctor.getId(), cursor.key); // No bookings can reference a malformed ID
+            if (nextFreeSlot(doctor, cursor.key, fromDate, fromMinute, lastDay, cursor.day, cursor.minute)) {
+                queue.push(cursor);
+            }
+        }
+        
+        vector<FreeSlot> slots;
+        while (slots.size() < count && !queue.empty()) {
+            Cursor cursor = queue.top();
+            queue.pop();
+            slots.push_back({cursor.doctor->getId(), cursor.day, TimeOfDay(cursor.minute)});
+            
+            if (nextFreeSlot(*cursor.doctor, cursor.key, cursor.day, cursor.minute + appointmentDurationMinutes,
+                             lastDay, cursor.day, cursor.minute)) {
+                queue.push(cursor);
+            }
+        }
+        return slots;
+    }
+
+    // CSV -> binary: writes the current data set as a snapshot image
+    void exportSnapshot() {
+        journal.commit();
+        persistence.replaceFiles({{snapshotFile, snapshotImage()}}, false);
+        persistence.waitDurable();
+    }
+    
+    // Binary -> CSV: replaces in-memory data with the snapshot plus the changes
+    // journaled since, then rewrites the CSV files
+    bool importSnapshot() {
+        journal.commit();
+        persistence.waitDurable(); // the files read below must be current
+        if (!loadSnapshot()) {
+            clearData();
+            loadData();
+            return false;
+        }
+        // The checkpoint below truncates the journal, so its records must be applied first
+        replayJournal();
+        restoreIdCounters();
+        historyStore.sync();
+        rebuildHistoryIndex();
+        dirty = DirtyCollections{true, true, true, true};
+        journal.checkpoint(dirtyFiles());
+        persistence.waitDurable();
+        return true;
+    }
+    
+    // Hands the journal to the background writer without waiting for the disk
+    void forceSaveDataForMenu() { // For explicit saving from menu operations
+        journal.commit();
+        if (journal.size() >= checkpointInterval) {
+            checkpoint();
         }
-        return it->second;
     }
     
-    const map<string, shared_ptr<Doctor>>& getAllDoctors() const {
-        return doctors;
+    // Runs `changes` with their journal records held back, writes them all as
+    // one group commit and then checkpoints. If a crash interrupts the
+    // checkpoint's file renames, replaying that commit repairs the files.
+    template <typename Changes>
+    void applyInBulk(Changes changes) {
+        journal.commit();
+        journal.holdCommits(true);
+        try {
+            changes();
+        } catch (...) {
+            journal.holdCommits(false);
+            checkpoint();
+            persistence.waitDurable();
+            throw;
+        }
+        journal.holdCommits(false);
+        checkpoint();
+        persistence.waitDurable();
+    }
+    
+    // Barrier: pending changes have been handed to the OS
+    void flushWrites() {
+        journal.commit();
+        persistence.flush();
+    }
+    
+    // Barrier: pending changes are on stable storage
+    void waitUntilDurable() {
+        journal.commit();
+        persistence.waitDurable();
+    }
+    
+    PersistenceMetrics getPersistenceMetrics() const {
+        return persistence.metrics();
+    }
+};
+
+// Micro-benchmarks run with --benchmark [records]; synthetic data only,
+// nothing is read from or written to the data files
+namespace Benchmark {
+    volatile size_t sink = 0; // Keeps measured loops from being optimized away
+    
+    template <typename Body>
+    double timeMilliseconds(Body body) {
+        auto started = chrono::steady_clock::now();
+        body();
+        return chrono::duration<double, milli>(chrono::steady_clock::now() - started).count();
     }
     
-    shared_ptr<Department> addDepartment(const string& name, const string& location) {
-        string id = generateId("DP");
-        auto department = make_shared<Department>(id, name, location);
-        departments[id] = department;
-        //saveDepartments();
-        return department;
+    // `operations` per second in millions; pass a byte count with unit "MB/s"
+    void report(const string& label, double milliseconds, size_t operations, const char* unit = "Mops/s") {
+        ostringstream line;
+        line << fixed << setprecision(1) << "  " << left << setw(34) << label << right << setw(10) << milliseconds << " ms"
+             << setprecision(1) << setw(10) << (operations / milliseconds * 1000.0 / 1e6) << " " << unit;
+        cout << line.str() << "\n";
     }
     
-    bool removeDepartment(const string& id) {
-        if (departments.find(id) == departments.end()) {
-            return false;
+    // std::map keyed by string (the previous table layout) against EntityTable
+    void entityTables(size_t records) {
+        vector<shared_ptr<Patient>> patients;
+        patients.reserve(records);
+        IdGenerator ids("P");
+        for (size_t i = 0; i < records; i++) {
+            patients.push_back(make_shared<Patient>(ids.next(), "Patient " + to_string(i), "F", to_string(900000000 + i),
+                                                    Date::parse("1980-01-01"), "O+", "Ins"));
         }
         
-        for (const auto& pair : doctors) {
-            if (pair.second->getDepartmentId() == id) {
-                throw runtime_error("Cannot remove department that has doctors assigned to it");
-            }
-        }
+        mt19937_64 random(42);
+        vector<string> hits;
+        vector<string> misses;
+        for (const auto& patient : patients) hits.push_back(patient->getId());
+        shuffle(hits.begin(), hits.end(), random);
+        IdGenerator unused("P");
+        unused.advancePast(records);
+        for (size_t i = 0; i < records; i++) misses.push_back(unused.next());
+        shuffle(misses.begin(), misses.end(), random);
         
-        departments.erase(id);
-        //saveDepartments();
-        return true;
+        size_t found = 0;
+        cout << "\nEntity tables, " << records << " patients\n";
+        
+        map<string, shared_ptr<Patient>> tree;
+        report("std::map insert", timeMilliseconds([&]() {
+            for (const auto& patient : patients) tree[patient->getId()] = patient;
+        }), records);
+        report("std::map lookup (hit)", timeMilliseconds([&]() {
+            for (const auto& id : hits) found += tree.find(id) != tree.end();
+        }), records);
+        report("std::map lookup (miss)", timeMilliseconds([&]() {
+            for (const auto& id : misses) found += tree.find(id) != tree.end();
+        }), records);
+        report("std::map ordered listing", timeMilliseconds([&]() {
+            for (const auto& pair : tree) found += pair.second->getName().size();
+        }), records);
+        
+        EntityTable<Patient> table;
+        report("EntityTable insert", timeMilliseconds([&]() {
+            for (const auto& patient : patients) table.put(patient);
+        }), records);
+        report("EntityTable lookup (hit)", timeMilliseconds([&]() {
+            for (const auto& id : hits) found += table.contains(id);
+        }), records);
+        report("EntityTable lookup (miss)", timeMilliseconds([&]() {
+            for (const auto& id : misses) found += table.contains(id);
+        }), records);
+        report("EntityTable ordered listing", timeMilliseconds([&]() {
+            for (const auto& patient : table.ordered()) found += patient->getName().size();
+        }), records);
+        report("EntityTable unordered scan", timeMilliseconds([&]() {
+            table.forEach([&](const shared_ptr<Patient>& patient) { found += patient->getName().size(); });
+        }), records);
+        
+        sink = found;
     }
     
-    shared_ptr<Department> getDepartment(const string& id) const {
-        auto it = departments.find(id);
-        if (it == departments.end()) {
-            return nullptr;
+    // Resident set size from /proc/self/statm, 0 where unavailable
+    size_t residentBytes() {
+#ifdef _WIN32
+        return 0;
+#else
+        ifstream statm("/proc/self/statm");
+        size_t totalPages = 0;
+        size_t residentPages = 0;
+        if (!(statm >> totalPages >> residentPages)) return 0;
+        return residentPages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+    }
+    
+    // Runs `body` in a child process where fork is available, so each
+    // measurement starts from the same heap
+    template <typename Body>
+    void isolated(Body body) {
+#ifdef _WIN32
+        body();
+#else
+        cout.flush();
+        pid_t child = fork();
+        if (child == 0) {
+            body();
+            cout.flush();
+            _exit(0);
+        }
+        if (child < 0) {
+            body();
+            return;
         }
-        return it->second;
+        waitpid(child, nullptr, 0);
+#endif
     }
     
-    const map<string, shared_ptr<Department>>& getAllDepartments() const {
-        return departments;
+    template <typename T, typename... Args>
+    shared_ptr<T> createEntity(bool pooled, Args&&... args) {
+        if (pooled) return EntityPool::create<T>(forward<Args>(args)...);
+        return make_shared<T>(forward<Args>(args)...);
     }
     
-    shared_ptr<Appointment> scheduleAppointment(const string& patientId, const string& doctorId,
-                                                    const string& date, const string& time) {
-        if (patients.find(patientId) == patients.end()) {
-            throw runtime_error("Patient does not exist");
+    // Builds synthetic patients and appointments once on the plain heap and
+    // once from the slab pools, attaching the appointments to a column store
+    // as Hospital does; reports time and resident memory growth
+    void entityAllocation(size_t records) {
+        const char* names[] = {"Alice", "Bob", "Carol", "David", "Eve", "Frank", "Grace", "Heidi"};
+        IdGenerator patientIds("P");
+        IdGenerator appointmentIds("A");
+        struct Row {
+            string patientId;
+            string name;
+            string phone;
+            string insurance;
+            string appointmentId;
+        };
+        vector<Row> rows;
+        rows.reserve(records);
+        for (size_t i = 0; i < records; i++) {
+            rows.push_back({patientIds.next(), string(names[i % 8]) + " " + names[i / 8 % 8] + "son",
+                            to_string(900000000 + i), "Ins" + to_string(i), appointmentIds.next()});
         }
+        Date dateOfBirth = Date::parse("1980-01-01");
+        Date day = Date::parse("2026-03-04");
+        TimeOfDay time = TimeOfDay::parse("10:30");
         
-        auto doc_it = doctors.find(doctorId);
-        if (doc_it == doctors.end()) {
-            throw runtime_error("Doctor does not exist");
+        cout << "\nEntity allocation, " << records << " patients and " << records << " appointments\n";
+        for (bool pooled : {false, true}) {
+            isolated([&]() {
+                AppointmentStore store;
+                vector<shared_ptr<Patient>> patients;
+                vector<shared_ptr<Appointment>> appointments;
+                patients.reserve(records);
+                appointments.reserve(records);
+                
+                size_t before = residentBytes();
+                double loadMilliseconds = timeMilliseconds([&]() {
+                    for (const auto& row : rows) {
+                        patients.push_back(createEntity<Patient>(pooled, row.patientId, row.name, "F", row.phone,
+                                                                 dateOfBirth, "O+", row.insurance));
+                        appointments.push_back(createEntity<Appointment>(pooled, row.appointmentId, row.patientId,
+                                                                         "D000001", day, time));
+                        appointments.back()->attach(store);
+                    }
+                });
+                size_t grown = residentBytes() - before;
+                double releaseMilliseconds = timeMilliseconds([&]() {
+                    patients.clear();
+                    appointments.clear();
+                });
+                
+                string mode = pooled ? "slab pools" : "make_shared";
+                report(mode + " load", loadMilliseconds, 2 * records);
+                report(mode + " release", releaseMilliseconds, 2 * records);
+                ostringstream line;
+                line << fixed << setprecision(1) << "  " << left << setw(34) << (mode + " resident growth") << right
+                     << setw(10) << grown / (1024.0 * 1024.0) << " MB";
+                cout << line.str() << "\n";
+            });
         }
+    }
+    
+    // "Scheduled appointments of one doctor in one month", once through the
+    // Appointment accessors of every view and once as a scan of the columns
+    void appointmentScans(size_t records) {
+        AppointmentStore store;
+        vector<shared_ptr<Appointment>> views; // Destroyed before the store
+        vector<string> doctorIds;
+        IdGenerator doctorGenerator("D");
+        for (int i = 0; i < 500; i++) doctorIds.push_back(doctorGenerator.next());
         
-        if (!DateUtil::isValidDateFormat(date)) {
-            throw runtime_error("Invalid date format. Expected YYYY-MM-DD");
+        mt19937 random(7);
+        IdGenerator appointmentIds("A");
+        Date first = Date::parse("2026-01-01");
+        views.reserve(records);
+        for (size_t i = 0; i < records; i++) {
+            uint32_t draw = static_cast<uint32_t>(random());
+            auto appointment = make_shared<Appointment>(appointmentIds.next(), "P000001", doctorIds[draw % 500],
+                                                        first.addDays(static_cast<int>(draw / 500 % 365)),
+                                                        TimeOfDay(9 * 60 + 30 * static_cast<int>(draw % 16)),
+                                                        static_cast<AppointmentStatus>(draw / 7 % 3));
+            appointment->attach(store);
+            views.push_back(appointment);
         }
         
-        auto doctor = doc_it->second; // Use iterator to get shared_ptr
-        if (!doctor->isAvailableOn(date)) {
-            throw runtime_error("Doctor is not available on the specified date");
-        }
+        const string doctorId = doctorIds[0];
+        Date from = Date::parse("2026-03-01");
+        Date to = Date::parse("2026-03-31");
+        AppointmentStore::Query query;
+        query.doctor = EntityKey::encode(doctorId);
+        query.from = AppointmentRecord::pack(from, TimeOfDay(0));
+        query.to = AppointmentRecord::pack(to.addDays(1), TimeOfDay(0));
+        query.onlyStatus(AppointmentStatus::Scheduled);
         
-        string id = generateId("A");
-        auto appointment = make_shared<Appointment>(id, patientId, doctorId, date, time);
-        appointments[id] = appointment;
-        //saveAppointments();
-        return appointment;
+        const int repeats = 10;
+        size_t viewMatches = 0;
+        size_t columnMatches = 0;
+        cout << "\nAppointment scans, " << records << " appointments, " << repeats << " scans each\n";
+        report("Appointment views", timeMilliseconds([&]() {
+            for (int r = 0; r < repeats; r++) {
+                for (const auto& appointment : views) {
+                    Date date = appointment->getDate();
+                    viewMatches += appointment->getDoctorId() == doctorId && appointment->getStatus() == "Scheduled" &&
+                                   date >= from && date <= to;
+                }
+            }
+        }), repeats * records);
+        report("AppointmentStore columns", timeMilliseconds([&]() {
+            for (int r = 0; r < repeats; r++) columnMatches += store.count(query);
+        }), repeats * records);
+        cout << "  " << viewMatches / repeats << " / " << columnMatches / repeats << " matches\n";
+        sink = viewMatches + columnMatches;
     }
     
-    bool cancelAppointment(const string& id) {
-        auto it = appointments.find(id);
-        if (it == appointments.end()) {
-            return false;
+    // Full roster listing (ID and name of every patient) and the patient-name
+    // join done when printing appointment lists
+    void patientRoster(size_t records) {
+        const char* names[] = {"Alice", "Bob", "Carol", "David", "Eve", "Frank", "Grace", "Heidi"};
+        EntityTable<Patient> patients;
+        vector<string> patientIds;
+        IdGenerator ids("P");
+        for (size_t i = 0; i < records; i++) {
+            string id = ids.next();
+            patients.put(Patient::deserialize(id + "," + names[i % 8] + " " + names[i / 8 % 8] + "son,F," +
+                                              to_string(900000000 + i) + ",1980-01-01,O+,@" + to_string(i * 64) +
+                                              ":2,Northwind Mutual policy " + to_string(700000000 + i)));
+            patientIds.push_back(id);
         }
         
-        it->second->setStatus("Cancelled");
-        //saveAppointments();
-        return true;
+        mt19937 random(11);
+        AppointmentStore store;
+        vector<shared_ptr<Appointment>> appointments; // Destroyed before the store
+        IdGenerator appointmentIds("A");
+        Date first = Date::parse("2026-01-01");
+        for (size_t i = 0; i < records; i++) {
+            uint32_t draw = static_cast<uint32_t>(random());
+            auto appointment = make_shared<Appointment>(appointmentIds.next(), patientIds[draw % records], "D000001",
+                                                        first.addDays(static_cast<int>(draw / 7 % 365)), TimeOfDay(600));
+            appointment->attach(store);
+            appointments.push_back(appointment);
+        }
+        
+        const int repeats = 5;
+        size_t touched = 0;
+        cout << "\nPatient roster, " << records << " patients, " << records << " appointments, "
+             << repeats << " passes each\n";
+        auto roster = patients.ordered();
+        report("Roster listing (ID order)", timeMilliseconds([&]() {
+            for (int r = 0; r < repeats; r++) {
+                for (const auto& patient : roster) touched += patient->getId().size() + patient->getName().size();
+            }
+        }), repeats * records);
+        report("Roster scan (table order)", timeMilliseconds([&]() {
+            for (int r = 0; r < repeats; r++) {
+                patients.forEach([&](const shared_ptr<Patient>& patient) { touched += patient->getName().size(); });
+            }
+        }), repeats * records);
+        report("Appointment -> patient name join", timeMilliseconds([&]() {
+            for (int r = 0; r < repeats; r++) {
+                for (const auto& appointment : appointments) {
+                    touched += patients.get(appointment->getPatientId())->getName().size();
+                }
+            }
+        }), repeats * records);
+        sink = touched;
     }
     
-    bool completeAppointment(const string& id, const string& notes) {
-        auto it = appointments.find(id);
-        if (it == appointments.end()) {
-            return false;
+    // Record and field splitting over appointment rows, a quarter of them with
+    // quoted notes, for the old getline loop and each CsvUtil::Scan version
+    void csvTokenizer(size_t records) {
+        string text;
+        IdGenerator ids("A");
+        for (size_t i = 0; i < records; i++) {
+            text += ids.next() + ",P" + to_string(100000 + i % 90000) + ",D000" + to_string(100 + i % 500) +
+                    ",2026-03-14,09:30,Scheduled,";
+            text += (i % 4 == 0) ? "\"Follow-up, bring \"\"old\"\" X-rays\"\n" : "Routine check\n";
         }
         
-        it->second->setStatus("Completed");
-        it->second->setNotes(notes);
-        
-        auto patient = getPatient(it->second->getPatientId());
-        auto doctor = getDoctor(it->second->getDoctorId());
+        const int repeats = 5;
+        size_t fields = 0;
+        cout << "\nCSV tokenizer, " << records << " rows, " << text.size() / 1024 << " KiB, " << repeats << " passes each\n";
+        report("getline per field", timeMilliseconds([&]() {
+            for (int r = 0; r < repeats; r++) {
+                istringstream input(text);
+                string line, field;
+                while (getline(input, line)) {
+                    istringstream row(line);
+                    while (getline(row, field, ',')) fields++;
+                }
+            }
+        }), repeats * text.size(), "MB/s");
         
-        if (patient && doctor) {
-            string historyEntry = "Appointment with Dr. " + doctor->getName() + 
-                                     " (" + doctor->getSpecialization() + ") on " + it->second->getDate() + " at " + it->second->getTime() + ": " + notes;
-            patient->addMedicalHistoryEntry(historyEntry);
-            //savePatients(); // Patient medical history changed
+        CsvUtil::Scan::Classifier previous = CsvUtil::Scan::active;
+        for (const auto& classifier : CsvUtil::Scan::available()) {
+            CsvUtil::Scan::active = classifier.second;
+            report(string("FieldReader (") + classifier.first + ")", timeMilliseconds([&]() {
+                for (int r = 0; r < repeats; r++) {
+                    CsvUtil::forEachRecord(text, [&](string_view record) {
+                        CsvUtil::FieldReader reader(record);
+                        while (reader.hasMore()) fields += reader.next().size() > 0;
+                    });
+                }
+            }), repeats * text.size(), "MB/s");
         }
-        //saveAppointments();
-        return true;
+        CsvUtil::Scan::active = previous;
+        sink = fields;
     }
     
-    shared_ptr<Appointment> getAppointment(const string& id) const {
-        auto it = appointments.find(id);
-        if (it == appointments.end()) {
-            return nullptr;
+    void run(size_t records) {
+        cout << "Benchmark mode\n";
+        entityAllocation(records); // First, so freed memory from other runs does not hide growth
+        entityTables(records);
+        appointmentScans(records);
+        patientRoster(records);
+        csvTokenizer(records);
+    }
+}
+
+// Non-interactive mode for scripted bulk changes such as nightly imports.
+// The input holds one command per CSV record, quoted like the data files:
+//
+//   add-patient,<name>,<gender>,<phone>,<date of birth>,<blood type>,<insurance>
+//   add-doctor,<name>,<gender>,<phone>,<specialization>,<license>,<department ID>
+//   add-department,<name>,<location>
+//   add-history,<patient ID>,<entry>
+//   schedule,<patient ID>,<doctor ID>,<date>,<time>
+//   complete,<appointment ID>[,<notes>]
+//   cancel,<appointment ID>
+//   available,<doctor ID>,<from>[,<to>]
+//   unavailable,<doctor ID>,<from>[,<to>]
+//   weekly,<doctor ID>,<weekdays>,<from>,<to>
+//   exclude,<doctor ID>,<weekdays>,<from>,<to>
+//
+// An ID written as @<line> names the record added by the command on that
+// earlier line. Records starting with '#' are comments. Every command is
+// checked before any is applied. The changes are journaled as one group
+// commit and then saved with one checkpoint.
+namespace Batch {
+    struct Verb {
+        const char* name;
+        const char* arguments; // One letter each: P/D/R/A an existing ID, d date, t time, w weekdays, s text
+        size_t required;
+        char creates; // ID letter of the record the command adds, 0 if none
+        string (*apply)(Hospital& hospital, const vector<string>& args);
+    };
+    
+    struct Command {
+        size_t line;
+        const Verb* verb;
+        vector<string> args;
+    };
+    
+    struct Failure {
+        size_t line;
+        string message;
+    };
+    
+    // Completing or cancelling needs an appointment that is still open
+    void requireScheduled(Hospital& hospital, const string& id) {
+        auto appointment = hospital.getAppointment(id);
+        if (!appointment) {
+            throw runtime_error("Appointment not found: " + id);
+        }
+        if (appointment->getStatusCode() != AppointmentStatus::Scheduled) {
+            throw runtime_error("Appointment " + id + " is " + appointment->getStatus());
         }
-        return it->second;
     }
     
-    const map<string, shared_ptr<Appointment>>& getAllAppointments() const {
-        return appointments;
+    AvailabilityRule ruleFrom(AvailabilityRule::Kind kind, const vector<string>& args) {
+        AvailabilityRule rule;
+        rule.kind = kind;
+        AvailabilityRule::parseWeekdays(args[1], rule.weekdays);
+        rule.from = Date::parse(args[2]);
+        rule.to = Date::parse(args[3]);
+        return rule;
     }
     
-    vector<shared_ptr<Appointment>> getPatientAppointments(const string& patientId) const {
-        vector<shared_ptr<Appointment>> result;
-        
-        for (const auto& pair : appointments) {
-            if (pair.second->getPatientId() == patientId) {
-                result.push_back(pair.second);
-            }
+    const Verb verbs[] = {
+        {"add-patient", "sssdss", 6, 'P', [](Hospital& hospital, const vector<string>& args) {
+            return hospital.addPatient(args[0], args[1], args[2], Date::parse(args[3]), args[4], args[5])->getId();
+        }},
+        {"add-doctor", "sssssR", 6, 'D', [](Hospital& hospital, const vector<string>& args) {
+            return hospital.addDoctor(args[0], args[1], args[2], args[3], args[4], args[5])->getId();
+        }},
+        {"add-department", "ss", 2, 'R', [](Hospital& hospital, const vector<string>& args) {
+            return hospital.addDepartment(args[0], args[1])->getId();
+        }},
+        {"add-history", "Ps", 2, 0, [](Hospital& hospital, const vector<string>& args) {
+            hospital.addMedicalHistoryEntry(args[0], args[1]);
+            return string();
+        }},
+        {"schedule", "PDdt", 4, 'A', [](Hospital& hospital, const vector<string>& args) {
+            return hospital.scheduleAppointment(args[0], args[1], Date::parse(args[2]), TimeOfDay::parse(args[3]))->getId();
+        }},
+        {"complete", "As", 1, 0, [](Hospital& hospital, const vector<string>& args) {
+            requireScheduled(hospital, args[0]);
+            hospital.completeAppointment(args[0], args.size() > 1 ? args[1] : "");
+            return string();
+        }},
+        {"cancel", "A", 1, 0, [](Hospital& hospital, const vector<string>& args) {
+            requireScheduled(hospital, args[0]);
+            hospital.cancelAppointment(args[0]);
+            return string();
+        }},
+        {"available", "Ddd", 2, 0, [](Hospital& hospital, const vector<string>& args) {
+            hospital.addDoctorAvailabilityRange(args[0], Date::parse(args[1]), Date::parse(args.back()));
+            return string();
+        }},
+        {"unavailable", "Ddd", 2, 0, [](Hospital& hospital, const vector<string>& args) {
+            hospital.removeDoctorAvailabilityRange(args[0], Date::parse(args[1]), Date::parse(args.back()));
+            return string();
+        }},
+        {"weekly", "Dwdd", 4, 0, [](Hospital& hospital, const vector<string>& args) {
+            hospital.addDoctorAvailabilityRule(args[0], ruleFrom(AvailabilityRule::Kind::Include, args));
+            return string();
+        }},
+        {"exclude", "Dwdd", 4, 0, [](Hospital& hospital, const vector<string>& args) {
+            hospital.addDoctorAvailabilityRule(args[0], ruleFrom(AvailabilityRule::Kind::Exclude, args));
+            return string();
+        }},
+    };
+    
+    const char* entityName(char letter) {
+        switch (letter) {
+            case 'P': return "patient";
+            case 'D': return "doctor";
+            case 'R': return "department";
+            default: return "appointment";
         }
-        
-        return result;
     }
     
-    vector<shared_ptr<Appointment>> getDoctorAppointments(const string& doctorId) const {
-        vector<shared_ptr<Appointment>> result;
-        
-        for (const auto& pair : appointments) {
-            if (pair.second->getDoctorId() == doctorId) {
-                result.push_back(pair.second);
+    // Line named by an "@<line>" argument, 0 if `value` is not one
+    size_t referencedLine(const string& value) {
+        if (value.size() < 2 || value.size() > 10 || value[0] != '@') return 0;
+        size_t line = 0;
+        for (size_t i = 1; i < value.size(); i++) {
+            if (!isdigit(static_cast<unsigned char>(value[i]))) return 0;
+            line = line * 10 + static_cast<size_t>(value[i] - '0');
+        }
+        return line;
+    }
+    
+    // `creators` maps the lines of earlier valid commands that add a record to its ID letter
+    void checkArgument(char type, const string& value, size_t line, const unordered_map<size_t, char>& creators,
+                       const Hospital& hospital, vector<Date>& dates) {
+        switch (type) {
+            case 'd': {
+                Date date;
+                if (!Date::tryParse(value, date)) {
+                    throw runtime_error("Invalid date '" + value + "', expected YYYY-MM-DD");
+                }
+                dates.push_back(date);
+                return;
+            }
+            case 't': {
+                TimeOfDay time;
+                if (!TimeOfDay::tryParse(value, time)) {
+                    throw runtime_error("Invalid time '" + value + "', expected HH:MM");
+                }
+                return;
+            }
+            case 'w': {
+                uint8_t mask;
+                if (!AvailabilityRule::parseWeekdays(value, mask)) {
+                    throw runtime_error("Invalid weekdays '" + value + "'");
+                }
+                return;
             }
+            case 's':
+                return;
         }
         
-        return result;
+        if (size_t target = referencedLine(value)) {
+            auto creator = creators.find(target);
+            if (target >= line || creator == creators.end() || creator->second != type) {
+                throw runtime_error(value + ": no " + entityName(type) + " is added on line " + to_string(target) +
+                                    " before this command");
+            }
+            return;
+        }
+        bool exists = (type == 'P' && hospital.getPatient(value)) || (type == 'D' && hospital.getDoctor(value)) ||
+                      (type == 'R' && hospital.getDepartment(value)) || (type == 'A' && hospital.getAppointment(value));
+        if (!exists) {
+            throw runtime_error(string("Unknown ") + entityName(type) + " ID '" + value + "'");
+        }
     }
     
-    vector<shared_ptr<Appointment>> getAppointmentsByDate(const string& date) const {
-        vector<shared_ptr<Appointment>> result;
-        
-        for (const auto& pair : appointments) {
-            if (pair.second->getDate() == date) {
-                result.push_back(pair.second);
+    // Validation pass: splits `text` into commands and checks each one's
+    // arguments against the loaded data and the commands before it
+    vector<Command> parse(string_view text, const Hospital& hospital, vector<Failure>& failures) {
+        vector<Command> commands;
+        unordered_map<size_t, char> creators;
+        size_t line = 1;
+        const char* counted = text.data();
+        // Retried lines of a merged record arrive in order too, so the count stays right
+        auto parseCommand = [&](string_view record) {
+            line += static_cast<size_t>(count(counted, record.data(), '\n'));
+            counted = record.data();
+            if (record[0] == '#') return;
+            
+            Command command{line, nullptr, {}};
+            CsvUtil::FieldReader fields(record);
+            string name(fields.next());
+            while (fields.hasMore()) {
+                command.args.emplace_back(fields.next());
+            }
+            
+            for (const Verb& verb : verbs) {
+                if (name == verb.name) command.verb = &verb;
+            }
+            if (!command.verb) {
+                throw runtime_error("Unknown command '" + name + "'");
+            }
+            
+            const Verb& verb = *command.verb;
+            size_t allowed = strlen(verb.arguments);
+            if (command.args.size() < verb.required || command.args.size() > allowed) {
+                throw runtime_error(name + " takes " + to_string(verb.required) +
+                                    (allowed > verb.required ? " to " + to_string(allowed) : string()) + " argument(s)");
+            }
+            
+            vector<Date> dates;
+            for (size_t i = 0; i < command.args.size(); i++) {
+                checkArgument(verb.arguments[i], command.args[i], line, creators, hospital, dates);
+            }
+            if (dates.size() == 2 && dates[1] < dates[0]) {
+                throw runtime_error("End date must not be before start date");
+            }
+            
+            if (verb.creates) {
+                creators[line] = verb.creates;
+            }
+            commands.push_back(move(command));
+        };
+        CsvUtil::forEachRecord(text, [&](string_view record) {
+            CsvUtil::parseRecovering(record, parseCommand, [&](string message) {
+                failures.push_back({line, move(message)});
+            });
+        });
+        return commands;
+    }
+    
+    // Runs the commands in order; a failed command does not stop the rest.
+    // The ID of every added record is written to `added`.
+    size_t apply(Hospital& hospital, const vector<Command>& commands, vector<Failure>& failures, ostream& added) {
+        unordered_map<size_t, string> addedIds;
+        size_t applied = 0;
+        hospital.applyInBulk([&]() {
+            for (const Command& command : commands) {
+                try {
+                    vector<string> args = command.args;
+                    for (size_t i = 0; i < args.size(); i++) {
+                        size_t target = isupper(static_cast<unsigned char>(command.verb->arguments[i]))
+                                            ? referencedLine(args[i]) : 0;
+                        if (target == 0) continue;
+                        auto id = addedIds.find(target);
+                        if (id == addedIds.end()) {
+                            throw runtime_error("Command on line " + to_string(target) + " failed");
+                        }
+                        args[i] = id->second;
+                    }
+                    
+                    string id = command.verb->apply(hospital, args);
+                    if (!id.empty()) {
+                        addedIds[command.line] = id;
+                        added << "Line " << command.line << ": added " << id << "\n";
+                    }
+                    applied++;
+                } catch (const exception& e) {
+                    failures.push_back({command.line, e.what()});
+                }
             }
+        });
+        return applied;
+    }
+    
+    // Reads commands from `source` ("-" for stdin). Returns the exit status:
+    // 0 if every command was applied, 1 otherwise.
+    int run(const string& source) {
+        string text;
+        if (source == "-") {
+            text.assign(istreambuf_iterator<char>(cin), istreambuf_iterator<char>());
+        } else {
+            ifstream in(source, ios::binary);
+            if (!in) {
+                throw runtime_error("Could not open batch file " + source);
+            }
+            text.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
         }
         
-        return result;
-    }
-
-    void forceSaveDataForMenu() const { // For explicit saving from menu operations
-        saveData();
+        Hospital hospital("General Hospital", "123 Healthcare Lane");
+        vector<Failure> failures;
+        
+        auto started = chrono::steady_clock::now();
+        vector<Command> commands = parse(text, hospital, failures);
+        auto validated = chrono::steady_clock::now();
+        size_t applied = apply(hospital, commands, failures, cout);
+        auto finished = chrono::steady_clock::now();
+        
+        stable_sort(failures.begin(), failures.end(), [](const Failure& a, const Failure& b) {
+            return a.line < b.line;
+        });
+        for (const auto& failure : failures) {
+            cerr << "Line " << failure.line << ": " << failure.message << "\n";
+        }
+        
+        double validateMilliseconds = chrono::duration<double, milli>(validated - started).count();
+        double applyMilliseconds = chrono::duration<double, milli>(finished - validated).count();
+        size_t total = applied + failures.size();
+        stringstream summary;
+        summary << fixed << setprecision(1)
+                << "Validated " << total << " command(s) in " << validateMilliseconds << " ms\n"
+                << "Applied and saved " << applied << " command(s) in " << applyMilliseconds << " ms\n"
+                << failures.size() << " command(s) failed\n"
+                << setprecision(0) << "Throughput: "
+                << total / max(validateMilliseconds + applyMilliseconds, 0.001) * 1000.0 << " commands/s\n";
+        cout << summary.str();
+        return failures.empty() ? 0 : 1;
     }
-};
+}
 
 void runHospitalSystem() {
     Hospital hospital("General Hospital", "123 Healthcare Lane");
     
+    for (const auto& timing : hospital.getLoadTimings()) {
+        stringstream elapsed;
+        elapsed << fixed << setprecision(1) << timing.milliseconds;
+        cout << "Loaded " << timing.records << " record(s) from " << timing.source
+             << " in " << elapsed.str() << " ms";
+        if (timing.errors > 0) {
+            cout << " (" << timing.errors << " error(s))";
+        }
+        cout << "\n";
+    }
+    
     int choice = 0;
     bool running = true;
     
@@ -799,7 +5522,8 @@ void runHospitalSystem() {
         cout << "2. Doctor Management\n";
         cout << "3. Department Management\n";
         cout << "4. Appointment Management\n";
-        cout << "5. Exit\n";
+        cout << "5. Data Maintenance\n";
+        cout << "6. Exit\n";
         cout << "Enter your choice: ";
         
         if (!(cin >> choice)) {
@@ -819,7 +5543,9 @@ void runHospitalSystem() {
                 cout << "2. View Patient Details\n";
                 cout << "3. List All Patients\n";
                 cout << "4. Add Medical History Entry\n";
-                cout << "5. Return to Main Menu\n";
+                cout << "5. Search Patients by Name or Phone\n";
+                cout << "6. Search Medical History\n";
+                cout << "7. Return to Main Menu\n";
                 cout << "Enter your choice: ";
                 cin >> patientChoice;
                 cin.ignore();
@@ -839,7 +5565,8 @@ void runHospitalSystem() {
                         
                         cout << "Enter date of birth (YYYY-MM-DD): ";
                         getline(cin, dob);
-                        if (!DateUtil::isValidDateFormat(dob)) {
+                        Date dobDate;
+                        if (!Date::tryParse(dob, dobDate)) {
                             cout << "Invalid date of birth format. Aborting.\n";
                             break;
                         }
@@ -851,7 +5578,7 @@ void runHospitalSystem() {
                         getline(cin, insurance);
                         
                         try {
-                            auto patient = hospital.addPatient(name, gender, phone, dob, bloodType, insurance);
+                            auto patient = hospital.addPatient(name, gender, phone, dobDate, bloodType, insurance);
                             hospital.forceSaveDataForMenu();
                             cout << "\nPatient added successfully with ID: " << patient->getId() << "\n";
                         } catch (const exception& e) {
@@ -885,13 +5612,13 @@ void runHospitalSystem() {
                         break;
                     }
                     case 3: {
-                        const auto& patients = hospital.getAllPatients();
+                        auto patients = hospital.getAllPatients();
                         if (patients.empty()) {
                             cout << "No patients registered in the system.\n";
                         } else {
                             cout << "\n----- Patient List -----\n";
-                            for (const auto& pair : patients) {
-                                cout << "ID: " << pair.first << " - Name: " << pair.second->getName() << "\n";
+                            for (const auto& patient : patients) {
+                                cout << "ID: " << patient->getId() << " - Name: " << patient->getName() << "\n";
                             }
                         }
                         break;
@@ -906,7 +5633,7 @@ void runHospitalSystem() {
                             cout << "Enter medical history entry: ";
                             getline(cin, entry);
                             
-                            patient->addMedicalHistoryEntry(entry);
+                            hospital.addMedicalHistoryEntry(id, entry);
                             hospital.forceSaveDataForMenu();
                             cout << "Medical history entry added successfully.\n";
                         } else {
@@ -914,7 +5641,48 @@ void runHospitalSystem() {
                         }
                         break;
                     }
-                    case 5:
+                    case 5: {
+                        string query;
+                        cout << "Enter name or phone (prefix or approximate): ";
+                        getline(cin, query);
+                        
+                        auto start = chrono::steady_clock::now();
+                        auto matches = hospital.searchPatients(query, 10);
+                        stringstream elapsed;
+                        elapsed << fixed << setprecision(3)
+                                << chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+                        
+                        if (matches.empty()) {
+                            cout << "No matching patients found.\n";
+                            break;
+                        }
+                        cout << "\n----- Matching Patients -----\n";
+                        for (const auto& patient : matches) {
+                            cout << "ID: " << patient->getId() << " - Name: " << patient->getName()
+                                 << " - Phone: " << patient->getPhoneNumber() << "\n";
+                        }
+                        cout << matches.size() << " match(es) in " << elapsed.str() << " ms\n";
+                        break;
+                    }
+                    case 6: {
+                        string query;
+                        cout << "Enter search words (diagnosis, drug, doctor...): ";
+                        getline(cin, query);
+                        
+                        auto matches = hospital.searchMedicalHistory(query, 20);
+                        if (matches.empty()) {
+                            cout << "No matching history entries found.\n";
+                            break;
+                        }
+                        cout << "\n----- Matching History Entries -----\n";
+                        for (const auto& match : matches) {
+                            auto patient = hospital.getPatient(match.patientId);
+                            cout << match.patientId << " - " << patient->getName() << "\n"
+                                 << "  " << patient->getMedicalHistory()[match.entryIndex] << "\n";
+                        }
+                        break;
+                    }
+                    case 7:
                         break;
                     default:
                         cout << "Invalid choice. Please try again.\n";
@@ -952,15 +5720,15 @@ void runHospitalSystem() {
                         cout << "Enter license number: ";
                         getline(cin, license);
                         
-                        const auto& departments = hospital.getAllDepartments();
+                        auto departments = hospital.getAllDepartments();
                         if (departments.empty()) {
                             cout << "\nNo departments available. Please add a department first.\n";
                             break;
                         }
                         
                         cout << "\nAvailable Departments:\n";
-                        for (const auto& pair : departments) {
-                            cout << "ID: " << pair.first << " - Name: " << pair.second->getName() << "\n";
+                        for (const auto& department : departments) {
+                            cout << "ID: " << department->getId() << " - Name: " << department->getName() << "\n";
                         }
                         
                         cout << "Enter department ID for the doctor: ";
@@ -1008,15 +5776,15 @@ void runHospitalSystem() {
                         break;
                     }
                     case 3: {
-                        const auto& doctors = hospital.getAllDoctors();
+                        auto doctors = hospital.getAllDoctors();
                         if (doctors.empty()) {
                             cout << "No doctors registered in the system.\n";
                         } else {
                             cout << "\n----- Doctor List -----\n";
-                            for (const auto& pair : doctors) {
-                                cout << "ID: " << pair.first 
-                                          << " - Name: " << pair.second->getName()
-                                          << " - Specialization: " << pair.second->getSpecialization() << "\n";
+                            for (const auto& doctor : doctors) {
+                                cout << "ID: " << doctor->getId() 
+                                          << " - Name: " << doctor->getName()
+                                          << " - Specialization: " << doctor->getSpecialization() << "\n";
                             }
                         }
                         break;
@@ -1036,24 +5804,117 @@ void runHospitalSystem() {
                         
                         cout << "\n1. Add available day\n";
                         cout << "2. Remove available day\n";
+                        cout << "3. Add available date range\n";
+                        cout << "4. Remove available date range\n";
+                        cout << "5. Add weekly availability rule\n";
+                        cout << "6. Add exception / holiday\n";
+                        cout << "7. Remove weekly rule or exception\n";
                         cout << "Enter your choice: ";
                         cin >> availChoice;
                         cin.ignore();
                         
+                        if (availChoice == 7) {
+                            const auto& rules = doctor->getAvailabilityRules();
+                            if (rules.empty()) {
+                                cout << "This doctor has no weekly rules or exceptions.\n";
+                                break;
+                            }
+                            for (size_t i = 0; i < rules.size(); i++) {
+                                cout << (i + 1) << ". " << rules[i].serialize() << "\n";
+                            }
+                            size_t ruleNumber = 0;
+                            cout << "Enter rule number to remove: ";
+                            cin >> ruleNumber;
+                            cin.ignore();
+                            
+                            if (ruleNumber > 0 && hospital.removeDoctorAvailabilityRule(id, ruleNumber - 1)) {
+                                hospital.forceSaveDataForMenu();
+                                cout << "Rule removed.\n";
+                            } else {
+                                cout << "Invalid rule number.\n";
+                            }
+                            break;
+                        }
+                        
+                        if (availChoice == 5 || availChoice == 6) {
+                            string weekdays = "all", fromDate, toDate;
+                            AvailabilityRule rule;
+                            rule.kind = (availChoice == 5) ? AvailabilityRule::Kind::Include
+                                                           : AvailabilityRule::Kind::Exclude;
+                            
+                            if (availChoice == 5) {
+                                cout << "Enter weekdays (e.g. Mon Tue Wed, or all): ";
+                                getline(cin, weekdays);
+                            }
+                            if (!AvailabilityRule::parseWeekdays(weekdays, rule.weekdays)) {
+                                cout << "Invalid weekdays. Use names such as Mon, Tue, ... Sun.\n";
+                                break;
+                            }
+                            
+                            cout << "Enter start date (YYYY-MM-DD): ";
+                            getline(cin, fromDate);
+                            cout << "Enter end date (YYYY-MM-DD): ";
+                            getline(cin, toDate);
+                            if (!Date::tryParse(fromDate, rule.from) || !Date::tryParse(toDate, rule.to)) {
+                                cout << "Invalid date format. Please use YYYY-MM-DD.\n";
+                                break;
+                            }
+                            if (rule.to < rule.from) {
+                                cout << "End date must not be before start date.\n";
+                                break;
+                            }
+                            
+                            hospital.addDoctorAvailabilityRule(id, rule);
+                            hospital.forceSaveDataForMenu();
+                            cout << (availChoice == 5 ? "Weekly rule added: " : "Exception added: ")
+                                 << rule.serialize() << "\n";
+                            break;
+                        }
+                        
+                        if (availChoice == 3 || availChoice == 4) {
+                            string fromDate, toDate;
+                            cout << "Enter start date (YYYY-MM-DD): ";
+                            getline(cin, fromDate);
+                            cout << "Enter end date (YYYY-MM-DD): ";
+                            getline(cin, toDate);
+                            
+                            Date from, to;
+                            if (!Date::tryParse(fromDate, from) || !Date::tryParse(toDate, to)) {
+                                cout << "Invalid date format. Please use YYYY-MM-DD.\n";
+                                break;
+                            }
+                            if (to < from) {
+                                cout << "End date must not be before start date.\n";
+                                break;
+                            }
+                            
+                            if (availChoice == 3) {
+                                hospital.addDoctorAvailabilityRange(id, from, to);
+                                hospital.forceSaveDataForMenu();
+                                cout << "Availability added from " << from << " to " << to << "\n";
+                            } else {
+                                hospital.removeDoctorAvailabilityRange(id, from, to);
+                                hospital.forceSaveDataForMenu();
+                                cout << "Availability removed from " << from << " to " << to << "\n";
+                            }
+                            break;
+                        }
+                        
                         cout << "Enter date (YYYY-MM-DD): ";
                         getline(cin, day);
                         
-                        if (!DateUtil::isValidDateFormat(day)) {
+                        Date dayDate;
+                        if (!Date::tryParse(day, dayDate)) {
                             cout << "Invalid date format. Please use YYYY-MM-DD.\n";
                             break;
                         }
                         
                         if (availChoice == 1) {
-                            doctor->addAvailableDay(day);
+                            hospital.addDoctorAvailability(id, dayDate);
                             hospital.forceSaveDataForMenu();
                             cout << "Availability added for " << day << "\n";
                         } else if (availChoice == 2) {
-                            doctor->removeAvailableDay(day);
+                            hospital.removeDoctorAvailability(id, dayDate);
                             hospital.forceSaveDataForMenu();
                             cout << "Availability removed for " << day << "\n";
                         } else {
@@ -1110,16 +5971,13 @@ void runHospitalSystem() {
                             dept->display();
                             
                             cout << "\nDoctors in this department:\n";
-                            bool found_doctors = false;
-                            for (const auto& pair : hospital.getAllDoctors()) {
-                                if (pair.second->getDepartmentId() == id) {
-                                    cout << "- " << pair.second->getName() 
-                                              << " (ID: " << pair.first << ")"
-                                              << " - " << pair.second->getSpecialization() << "\n";
-                                    found_doctors = true;
-                                }
+                            auto deptDoctors = hospital.getDoctorsInDepartment(id);
+                            for (const auto& doctor : deptDoctors) {
+                                cout << "- " << doctor->getName() 
+                                          << " (ID: " << doctor->getId() << ")"
+                                          << " - " << doctor->getSpecialization() << "\n";
                             }
-                            if (!found_doctors) {
+                            if (deptDoctors.empty()) {
                                 cout << "No doctors assigned to this department.\n";
                             }
                         } else {
@@ -1128,15 +5986,15 @@ void runHospitalSystem() {
                         break;
                     }
                     case 3: {
-                        const auto& departments = hospital.getAllDepartments();
+                        auto departments = hospital.getAllDepartments();
                         if (departments.empty()) {
                             cout << "No departments registered in the system.\n";
                         } else {
                             cout << "\n----- Department List -----\n";
-                            for (const auto& pair : departments) {
-                                cout << "ID: " << pair.first 
-                                          << " - Name: " << pair.second->getName()
-                                          << " - Location: " << pair.second->getLocation() << "\n";
+                            for (const auto& department : departments) {
+                                cout << "ID: " << department->getId() 
+                                          << " - Name: " << department->getName()
+                                          << " - Location: " << department->getLocation() << "\n";
                             }
                         }
                         break;
@@ -1172,7 +6030,10 @@ void runHospitalSystem() {
                 cout << "3. List Appointments by Date\n";
                 cout << "4. Complete Appointment\n";
                 cout << "5. Cancel Appointment\n";
-                cout << "6. Return to Main Menu\n";
+                cout << "6. List Appointments in Date Range\n";
+                cout << "7. Doctor Calendar (Day/Week)\n";
+                cout << "8. Find Next Free Slots\n";
+                cout << "9. Return to Main Menu\n";
                 cout << "Enter your choice: ";
                 cin >> apptChoice;
                 cin.ignore();
@@ -1181,31 +6042,31 @@ void runHospitalSystem() {
                     case 1: {
                         string patientId, doctorId, date, time;
                         
-                        const auto& patients = hospital.getAllPatients();
+                        auto patients = hospital.getAllPatients();
                         if (patients.empty()) {
                             cout << "No patients available. Please add a patient first.\n";
                             break;
                         }
                         
                         cout << "\nAvailable Patients:\n";
-                        for (const auto& pair : patients) {
-                            cout << "ID: " << pair.first << " - Name: " << pair.second->getName() << "\n";
+                        for (const auto& patient : patients) {
+                            cout << "ID: " << patient->getId() << " - Name: " << patient->getName() << "\n";
                         }
                         
                         cout << "Enter patient ID: ";
                         getline(cin, patientId);
                         
-                        const auto& doctors = hospital.getAllDoctors();
+                        auto doctors = hospital.getAllDoctors();
                         if (doctors.empty()) {
                             cout << "No doctors available. Please add a doctor first.\n";
                             break;
                         }
                         
                         cout << "\nAvailable Doctors:\n";
-                        for (const auto& pair : doctors) {
-                            cout << "ID: " << pair.first 
-                                      << " - Name: " << pair.second->getName()
-                                      << " - Specialization: " << pair.second->getSpecialization() << "\n";
+                        for (const auto& doctor : doctors) {
+                            cout << "ID: " << doctor->getId() 
+                                      << " - Name: " << doctor->getName()
+                                      << " - Specialization: " << doctor->getSpecialization() << "\n";
                         }
                         
                         cout << "Enter doctor ID: ";
@@ -1213,20 +6074,26 @@ void runHospitalSystem() {
                         
                         auto doctor = hospital.getDoctor(doctorId);
                         if (doctor) {
-                            cout << "\nDoctor's Available Days: ";
-                            const auto& availableDays = doctor->getAvailableDays();
-                            if (availableDays.empty()) {
+                            cout << "\nDoctor's Upcoming Available Days: ";
+                            if (!doctor->hasAvailability()) {
                                 cout << "No availability set for this doctor.\n";
                                 break; 
-                            } else {
-                                bool first = true;
-                                for (const auto& day_entry : availableDays) {
-                                    if(!first) cout << ", ";
-                                    cout << day_entry;
-                                    first = false;
-                                }
-                                cout << "\n";
                             }
+                            
+                            const int maxShown = 14;
+                            int shown = 0;
+                            Date day;
+                            for (Date from = Date::today(); shown < maxShown && doctor->nextAvailableDay(from, day);
+                                 from = day.addDays(1)) {
+                                if (shown > 0) cout << ", ";
+                                cout << day;
+                                shown++;
+                            }
+                            if (shown == 0) {
+                                cout << "No upcoming availability for this doctor.\n";
+                                break;
+                            }
+                            cout << (shown == maxShown ? ", ..." : "") << "\n";
                         } else {
                             cout << "Doctor not found. Cannot show availability.\n";
                             break;
@@ -1239,7 +6106,8 @@ void runHospitalSystem() {
                         getline(cin, time);
                         
                         try {
-                            auto appointment = hospital.scheduleAppointment(patientId, doctorId, date, time);
+                            auto appointment = hospital.scheduleAppointment(patientId, doctorId, Date::parse(date),
+                                                                           TimeOfDay::parse(time));
                             hospital.forceSaveDataForMenu();
                             cout << "\nAppointment scheduled successfully with ID: " << appointment->getId() << "\n";
                         } catch (const exception& e) {
@@ -1278,12 +6146,13 @@ void runHospitalSystem() {
                         cout << "Enter date (YYYY-MM-DD): ";
                         getline(cin, date);
                         
-                        if (!DateUtil::isValidDateFormat(date)) {
+                        Date day;
+                        if (!Date::tryParse(date, day)) {
                             cout << "Invalid date format. Please use YYYY-MM-DD.\n";
                             break;
                         }
                         
-                        auto appointments = hospital.getAppointmentsByDate(date);
+                        auto appointments = hospital.getAppointmentsByDate(day);
                         
                         if (appointments.empty()) {
                             cout << "No appointments found for date: " << date << "\n";
@@ -1313,12 +6182,12 @@ void runHospitalSystem() {
                             break;
                         }
                         
-                        if (appointment->getStatus() == "Completed") {
+                        if (appointment->getStatusCode() == AppointmentStatus::Completed) {
                             cout << "This appointment is already completed.\n";
                             break;
                         }
                         
-                        if (appointment->getStatus() == "Cancelled") {
+                        if (appointment->getStatusCode() == AppointmentStatus::Cancelled) {
                             cout << "Cannot complete a cancelled appointment.\n";
                             break;
                         }
@@ -1345,12 +6214,12 @@ void runHospitalSystem() {
                             break;
                         }
                         
-                        if (appointment->getStatus() == "Completed") {
+                        if (appointment->getStatusCode() == AppointmentStatus::Completed) {
                             cout << "Cannot cancel a completed appointment.\n";
                             break;
                         }
                         
-                        if (appointment->getStatus() == "Cancelled") {
+                        if (appointment->getStatusCode() == AppointmentStatus::Cancelled) {
                             cout << "This appointment is already cancelled.\n";
                             break;
                         }
@@ -1363,14 +6232,196 @@ void runHospitalSystem() {
                         }
                         break;
                     }
-                    case 6:
+                    case 6: {
+                        string fromDate, toDate;
+                        cout << "Enter start date (YYYY-MM-DD): ";
+                        getline(cin, fromDate);
+                        cout << "Enter end date (YYYY-MM-DD): ";
+                        getline(cin, toDate);
+                        
+                        Date from, to;
+                        if (!Date::tryParse(fromDate, from) || !Date::tryParse(toDate, to)) {
+                            cout << "Invalid date format. Please use YYYY-MM-DD.\n";
+                            break;
+                        }
+                        if (to < from) {
+                            cout << "End date must not be before start date.\n";
+                            break;
+                        }
+                        
+                        auto appointments = hospital.getAppointmentsBetween(from, to);
+                        
+                        if (appointments.empty()) {
+                            cout << "No appointments found between " << fromDate << " and " << toDate << "\n";
+                        } else {
+                            cout << "\n----- Appointments from " << fromDate << " to " << toDate << " -----\n";
+                            for (const auto& appointment : appointments) {
+                                auto patient = hospital.getPatient(appointment->getPatientId());
+                                auto doctor = hospital.getDoctor(appointment->getDoctorId());
+                                
+                                cout << "ID: " << appointment->getId()
+                                          << " - Date: " << appointment->getDate()
+                                          << " - Time: " << appointment->getTime()
+                                          << " - Patient: " << (patient ? patient->getName() : "Unknown")
+                                          << " - Doctor: " << (doctor ? doctor->getName() : "Unknown")
+                                          << " - Status: " << appointment->getStatus() << "\n";
+                            }
+                            cout << "Total: " << appointments.size() << " appointment(s)\n";
+                        }
+                        break;
+                    }
+                    case 7: {
+                        string doctorId, startDate;
+                        int viewChoice = 0;
+                        cout << "Enter doctor ID: ";
+                        getline(cin, doctorId);
+                        
+                        auto doctor = hospital.getDoctor(doctorId);
+                        if (!doctor) {
+                            cout << "Doctor not found with ID: " << doctorId << "\n";
+                            break;
+                        }
+                        
+                        cout << "1. Day view\n";
+                        cout << "2. Week view\n";
+                        cout << "Enter your choice: ";
+                        cin >> viewChoice;
+                        cin.ignore();
+                        if (viewChoice != 1 && viewChoice != 2) {
+                            cout << "Invalid choice.\n";
+                            break;
+                        }
+                        
+                        cout << "Enter start date (YYYY-MM-DD): ";
+                        getline(cin, startDate);
+                        Date start;
+                        if (!Date::tryParse(startDate, start)) {
+                            cout << "Invalid date format. Please use YYYY-MM-DD.\n";
+                            break;
+                        }
+                        
+                        int days = (viewChoice == 1) ? 1 : 7;
+                        Date endDate = start.addDays(days - 1);
+                        auto appointments = hospital.getDoctorCalendar(doctorId, start, endDate);
+                        
+                        cout << "\n----- Calendar for Dr. " << doctor->getName()
+                             << " (" << startDate << " to " << endDate << ") -----\n";
+                        size_t next = 0;
+                        for (int offset = 0; offset < days; offset++) {
+                            Date day = start.addDays(offset);
+                            cout << day << (doctor->isAvailableOn(day) ? "" : " (not available)") << "\n";
+                            
+                            bool any = false;
+                            for (; next < appointments.size() && appointments[next]->getDate() == day; next++) {
+                                auto patient = hospital.getPatient(appointments[next]->getPatientId());
+                                cout << "  " << appointments[next]->getTime()
+                                     << " - " << (patient ? patient->getName() : "Unknown")
+                                     << " (ID: " << appointments[next]->getId() << ")"
+                                     << " - " << appointments[next]->getStatus() << "\n";
+                                any = true;
+                            }
+                            if (!any) {
+                                cout << "  No appointments\n";
+                            }
+                        }
+                        break;
+                    }
+                    case 8: {
+                        string criterion, startDate;
+                        int count = 0;
+                        cout << "Enter specialization or department ID: ";
+                        getline(cin, criterion);
+                        cout << "Enter start date (YYYY-MM-DD): ";
+                        getline(cin, startDate);
+                        Date start;
+                        if (!Date::tryParse(startDate, start)) {
+                            cout << "Invalid date format. Please use YYYY-MM-DD.\n";
+                            break;
+                        }
+                        cout << "How many slots: ";
+                        cin >> count;
+                        cin.ignore();
+                        if (count <= 0) {
+                            cout << "Invalid number of slots.\n";
+                            break;
+                        }
+                        
+                        auto slots = hospital.findFreeSlots(criterion, start, count);
+                        if (slots.empty()) {
+                            cout << "No free slots found.\n";
+                            break;
+                        }
+                        
+                        cout << "\n----- Free Slots -----\n";
+                        for (const auto& slot : slots) {
+                            auto doctor = hospital.getDoctor(slot.doctorId);
+                            cout << slot.date << " " << slot.time
+                                 << " - Dr. " << (doctor ? doctor->getName() : "Unknown")
+                                 << " (ID: " << slot.doctorId << ")\n";
+                        }
+                        break;
+                    }
+                    case 9:
+                        break;
+                    default:
+                        cout << "Invalid choice. Please try again.\n";
+                }
+                break;
+            }
+            case 5: {
+                int dataChoice = 0;
+                cout << "\n----- Data Maintenance -----\n";
+                cout << "1. Export Binary Snapshot (CSV -> binary)\n";
+                cout << "2. Rebuild CSV Files from Snapshot (binary -> CSV)\n";
+                cout << "3. Persistence Status\n";
+                cout << "4. Return to Main Menu\n";
+                cout << "Enter your choice: ";
+                cin >> dataChoice;
+                cin.ignore();
+                
+                switch (dataChoice) {
+                    case 1: {
+                        try {
+                            hospital.exportSnapshot();
+                            cout << "Snapshot written.\n";
+                        } catch (const exception& e) {
+                            cerr << "Error: " << e.what() << endl;
+                        }
+                        break;
+                    }
+                    case 2: {
+                        try {
+                            if (hospital.importSnapshot()) {
+                                cout << "CSV files rebuilt from snapshot.\n";
+                            } else {
+                                cout << "Snapshot could not be loaded; data left unchanged.\n";
+                            }
+                        } catch (const exception& e) {
+                            cerr << "Error: " << e.what() << endl;
+                        }
+                        break;
+                    }
+                    case 3: {
+                        PersistenceMetrics metrics = hospital.getPersistenceMetrics();
+                        stringstream lag, latency;
+                        lag << fixed << setprecision(2) << metrics.lagMilliseconds;
+                        latency << fixed << setprecision(2) << metrics.lastLatencyMilliseconds;
+                        cout << "\n----- Persistence Status -----\n";
+                        cout << "Queue depth: " << metrics.queueDepth << " batch(es)\n";
+                        cout << "Current lag: " << lag.str() << " ms\n";
+                        cout << "Batches submitted: " << metrics.submitted
+                             << ", written in " << metrics.writes << " pass(es)\n";
+                        cout << "Last write latency: " << latency.str() << " ms\n";
+                        break;
+                    }
+                    case 4:
                         break;
                     default:
                         cout << "Invalid choice. Please try again.\n";
                 }
                 break;
             }
-            case 5:
+            case 6:
                 cout << "Exiting the system. Thank you!\n";
                 running = false;
                 break;
@@ -1380,8 +6431,15 @@ void runHospitalSystem() {
     }
 }
 
-int main() {
+int main(int argc, char* argv[]) {
     try {
+        if (argc > 1 && string(argv[1]) == "--benchmark") {
+            Benchmark::run(argc > 2 ? stoul(argv[2]) : 200000);
+            return 0;
+        }
+        if (argc > 1 && string(argv[1]) == "--batch") {
+            return Batch::run(argc > 2 ? argv[2] : "-");
+        }
         runHospitalSystem();
     } catch (const exception& e) {
         cerr << "Fatal error: " << e.what() << endl;